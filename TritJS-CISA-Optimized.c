@@ -2,10 +2,24 @@
  * TritJS-CISA-Optimized: A Ternary Calculator with Advanced Features
  *
  * This program has been optimized for:
- *   - Improved memory management and safe dynamic reallocation.
- *   - Faster base conversion by grouping four base‑3 digits at a time.
- *   - Efficient multiplication using a Karatsuba algorithm (with a fallback
- *     to naïve multiplication for small inputs).
+ *   - Improved memory management and safe dynamic reallocation. Large
+ *     buffers live in anonymous or memfd mappings aligned for transparent
+ *     huge pages; backing them with a file is an explicit spill mode.
+ *     Small values live inside the struct, and copies and cached products
+ *     share large buffers until one side is written.
+ *   - Word-sized limbs: each 64-bit limb packs 40 trits (3^40 < 2^64), so
+ *     arithmetic loops run ten times fewer iterations than one base‑81
+ *     digit per byte, with 128-bit intermediate products.
+ *   - Linear-time base conversion, since every limb maps to 40 fixed trits,
+ *     and divide-and-conquer decimal input over cached powers of ten.
+ *   - Size-tiered multiplication: schoolbook, Karatsuba, Toom-3, Toom-4 and
+ *     an exact three-prime NTT. `--bench-mul` reports the crossovers and
+ *     `--tune` saves them as per-machine cutoffs loaded at startup.
+ *     Products past the par_mul cutoff fork their sub-products onto a
+ *     worker pool. `--self-check` runs every tier at tiny cutoffs against
+ *     the schoolbook kernels.
+ *   - Batch entry points over structure-of-arrays operands, so millions of
+ *     small values cost a handful of buffers, with AVX2 across values.
  *   - Enhanced security including file locking on audit logs and secure memory
  *     zeroing (where supported) using FIPS–validated crypto.
  *   - Real-time intrusion detection via a background monitoring thread.
@@ -14,7 +28,9 @@
  *
  * == Features ==
  * • Arithmetic: add, sub, mul, div, pow, fact
- * • Scientific: sqrt, log3, sin, cos, tan, pi (via double conversion)
+ * • Scientific: sqrt, log3, sin, cos, tan, pi as arbitrary-precision
+ *   fixed-point results to the requested precision in trits; pi, e and
+ *   ln 3 come from binary splitting
  * • Conversions: bin2tri, tri2bin (optimized conversion routines),
  *   balanced/unbalanced ternary parsing
  * • State Management: save and load encrypted/signed session states
@@ -42,8 +58,10 @@
  * GNU General Public License (GPL)
  ***********************************************************************/
 
+#define _GNU_SOURCE   /* memfd_create, mremap */
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <math.h>
 #include <sys/mman.h>
@@ -63,6 +81,9 @@
 #include <lua.h>
 #include <lualib.h>
 #include <lauxlib.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 /* Global Configuration */
 #define ENABLE_VERBOSE_LOGGING 1
@@ -70,6 +91,36 @@
 
 #define BASE_81 81
 #define T81_MMAP_THRESHOLD (500 * 1024)
+#define T81_MAP_BACKEND 0         /* Mapped buffers: 0 anonymous, 1 memfd, 2 file spill */
+#define T81_HUGE_PAGE (2 * 1024 * 1024)
+#define T81_MUL_CACHE_BYTES (64 * 1024 * 1024)   /* Memory bound for cached products */
+
+/* Compiled-in multiplication cutoffs, in limbs. `tritjs --tune` measures
+   per-machine values and the tuning file overrides these at startup.
+   Karatsuba's middle product is (n/2 + 1) limbs, so its cutoff must stay
+   above 2. Products whose shorter operand reaches the NTT cutoff never
+   reach Toom-4, so with these defaults Toom-4 is off: the NTT overtakes
+   Toom-3 before Toom-4 does on the machines measured so far. A tuning
+   file with an NTT cutoff above the Toom-4 one turns it back on. */
+#define T81_KARATSUBA_THRESHOLD 16
+#define T81_TOOM3_THRESHOLD 48
+#define T81_TOOM4_THRESHOLD 512   /* Unreachable below T81_NTT_THRESHOLD */
+#define T81_NTT_THRESHOLD 192
+#define T81_DIV_DC_THRESHOLD 32   /* Divisor limbs for divide-and-conquer division */
+#define T81_DIV_NEWTON_THRESHOLD 192   /* Divisor limbs for reciprocal division */
+#define T81_THREADS 0             /* Worker threads; 0 uses every online CPU */
+#define T81_PAR_MUL_THRESHOLD 1024   /* Operand limbs before a product forks */
+#define T81_INLINE_LIMBS 2        /* Limbs a T81BigInt holds without a buffer */
+
+/* Limb arithmetic: one limb holds 40 trits (ten base-81 digits).
+   3^40 has its top bit set, so it is already a normalized divisor for the
+   128-by-64 division-by-invariant-integer step in t81_limb_divmod(). */
+typedef uint64_t T81Limb;
+typedef unsigned __int128 T81DLimb;
+#define T81_LIMB_TRITS 40
+#define T81_LIMB_DIGITS81 10
+#define T81_LIMB_BASE 12157665459056928801ULL      /* 3^40 */
+#define T81_LIMB_BASE_INV 9542376705020462653ULL   /* floor((2^128-1)/3^40) - 2^64 */
 
 /* Error codes: 0=OK, 1=MemAlloc, 2=InvalidInput, 3=DivZero, 4=Overflow,
    5=Undefined, 6=Negative, 7=PrecisionErr, 8=MMapFail, 9=ScriptErr */
@@ -81,15 +132,35 @@ typedef int TritError;
 #endif
 
 /* Data Structures */
+/* Values of up to T81_INLINE_LIMBS limbs live in inl, with limbs pointing
+   at it, so any 40-trit value and the sum or product of two of them needs
+   no buffer. Since limbs may point into the struct itself, values are
+   exchanged with t81bigint_swap(), never by struct assignment.
+   Larger buffers can be shared copy-on-write between values (see
+   tritjs_copy), with refs counting the holders. Anything that writes limbs
+   first goes through t81bigint_reserve() or allocate_digits(), which give
+   the value a private buffer again. */
 typedef struct {
     int sign;                 /* 0 = positive, 1 = negative */
-    unsigned char *digits;    /* Array of base‑81 digits (little-endian) */
-    size_t len;               /* Number of digits */
-    int is_mapped;            /* 1 if allocated with mmap */
-    int fd;                   /* File descriptor (if using mmap) */
-    char tmp_path[32];        /* Temporary file path */
+    T81Limb *limbs;           /* Array of base‑3^40 limbs (little-endian) */
+    size_t len;               /* Number of limbs in use */
+    size_t capacity;          /* Number of limbs allocated */
+    int is_mapped;            /* 0 on the heap, else 1 + the map backend */
+    unsigned long *refs;      /* Holders of a shared buffer, NULL if private */
+    T81Limb inl[T81_INLINE_LIMBS];  /* Storage for small values */
 } T81BigInt;
 
+/* A divisor prepared for repeated division: scaled to a normalized top
+   limb, with its reciprocal floor(3^(80n) / limbs), so that every later
+   division is two multiplies. */
+typedef struct {
+    T81Limb *limbs;           /* Divisor times scale, n limbs */
+    T81Limb *inv;             /* Reciprocal, n + 1 limbs */
+    size_t n;
+    T81Limb scale;
+    int sign;
+} T81Reciprocal;
+
 typedef struct {
     int sign;
     unsigned char* integer;   /* Base‑81 digits for integer part */
@@ -101,6 +172,47 @@ typedef struct {
     char f_tmp_path[32];
 } T81Float;
 
+/* A trit vector as two bitplanes: bit i of p is set when trit i is at
+   least 1 and bit i of q when it is 2, so min, max and 2 - t are plain
+   AND, OR and swapped complements. Bits at and above `trits` are zero. */
+typedef struct {
+    uint64_t *p, *q;
+    size_t trits;             /* Trits in the vector */
+    size_t words;             /* Words in use per plane */
+    size_t capacity;          /* Words allocated per plane */
+} T81TritPlanes;
+
+/* Integers in structure-of-arrays form for the batch operations: value i
+   is sign[i] and the len[i] >= 1 limbs at limbs + off[i]. All values
+   share one limb array, so a batch of any size is four buffers. A zeroed
+   T81Batch is an empty batch. */
+typedef struct {
+    T81Limb *limbs;           /* Limbs of every value, packed in order */
+    size_t *off;              /* Start of value i in limbs */
+    size_t *len;              /* Limbs in use by value i */
+    unsigned char *sign;      /* 0 = positive, else negative, per value */
+    size_t n;                 /* Values in the batch */
+    size_t used;              /* Limbs up to the end of the last value */
+    size_t capacity;          /* Limbs allocated */
+    size_t slots;             /* Values allocated */
+} T81Batch;
+
+/* Product cache counters, summed over all shards. */
+typedef struct {
+    unsigned long long hits, misses, evictions;
+    size_t entries, bytes;
+} T81CacheStats;
+
+/* Counters for one context (see tritjs_context_new). */
+typedef struct {
+    T81CacheStats cache;
+    unsigned long long maps, unmaps;  /* Large buffers mapped and unmapped */
+    unsigned long long mapped_bytes;  /* Bytes mapped in total */
+    unsigned long long errors;        /* Errors logged */
+} T81ContextStats;
+
+typedef struct T81Context T81Context;
+
 typedef struct {
     T81Float real;
     T81Float imag;
@@ -124,6 +236,30 @@ static FILE* audit_log = NULL;
 static long total_mapped_bytes = 0;
 static int operation_steps = 0;
 
+/* Runtime cutoffs: compiled defaults until the tuning file is loaded. */
+typedef struct {
+    size_t mmap_bytes, mul_cache_bytes;
+    size_t karatsuba, toom3, toom4, ntt;   /* In limbs */
+    size_t div_dc, div_newton;
+    size_t threads;
+    size_t map_backend;
+    size_t par_mul;
+} T81Tuning;
+static T81Tuning t81_tuning = { T81_MMAP_THRESHOLD, T81_MUL_CACHE_BYTES, T81_KARATSUBA_THRESHOLD,
+                                T81_TOOM3_THRESHOLD, T81_TOOM4_THRESHOLD, T81_NTT_THRESHOLD,
+                                T81_DIV_DC_THRESHOLD, T81_DIV_NEWTON_THRESHOLD, T81_THREADS,
+                                T81_MAP_BACKEND, T81_PAR_MUL_THRESHOLD };
+
+/* The state of one independent computation; see Contexts below. */
+struct T81Context {
+    T81Tuning *tuning;        /* &own, or the process tuning for the default */
+    T81Tuning own;
+    struct MulCacheShard *cache;   /* MUL_CACHE_SHARDS product cache shards */
+    FILE *log;                /* Error sink; NULL uses the audit log */
+    unsigned long long maps, unmaps, mapped_bytes, errors;
+};
+static T81Context* t81_ctx(void);
+
 #define MAX_HISTORY 10
 static char* history[MAX_HISTORY] = {0};
 static int history_count = 0;
@@ -138,21 +274,73 @@ static WINDOW *input_win, *output_win, *status_win;
 TritError tritjs_add_big(T81BigInt* A, T81BigInt* B, T81BigInt** result);
 TritError tritjs_subtract_big(T81BigInt* A, T81BigInt* B, T81BigInt** result);
 TritError tritjs_multiply_big(T81BigInt* a, T81BigInt* b, T81BigInt** result);
+TritError tritjs_square_big(T81BigInt* a, T81BigInt** result);
+TritError tritjs_add_into(T81BigInt* dst, const T81BigInt* A, const T81BigInt* B);
+TritError tritjs_sub_into(T81BigInt* dst, const T81BigInt* A, const T81BigInt* B);
+TritError tritjs_mul_into(T81BigInt* dst, const T81BigInt* a, const T81BigInt* b);
+TritError tritjs_copy(T81BigInt* x, T81BigInt** out);
+int tritjs_compare(const T81BigInt* a, const T81BigInt* b);
+void tritjs_mul_cache_stats(T81CacheStats *out);
+void tritjs_mul_cache_clear(void);
+void tritjs_scratch_release(void);
+void tritjs_bench_multiply(FILE *out);
+TritError tritjs_tune(const char *path, FILE *out);
+TritError tritjs_load_tuning(const char *path);
+TritError tritjs_save_tuning(const char *path);
+TritError tritjs_set_map_backend(const char *name);
+T81Context* tritjs_context_new(void);
+void tritjs_context_free(T81Context* ctx);
+T81Context* tritjs_context_use(T81Context* ctx);
+TritError tritjs_context_set(T81Context* ctx, const char *key, size_t value);
+void tritjs_context_set_log(T81Context* ctx, FILE* log);
+void tritjs_context_stats(T81Context* ctx, T81ContextStats* out);
 TritError tritjs_factorial_big(T81BigInt* a, T81BigInt** result);
 TritError tritjs_power_big(T81BigInt* base, T81BigInt* exp, T81BigInt** result);
 TritError tritjs_divide_big(T81BigInt* a, T81BigInt* b, T81BigInt** quotient, T81BigInt** remainder);
+TritError tritjs_reciprocal_init(T81Reciprocal* r, const T81BigInt* b);
+TritError tritjs_divide_reciprocal(T81BigInt* a, const T81Reciprocal* r, T81BigInt** quotient, T81BigInt** remainder);
+void tritjs_reciprocal_free(T81Reciprocal* r);
 TritError tritjs_sqrt_complex(T81BigInt* a, int precision, T81Complex* result);
 TritError tritjs_log3_complex(T81BigInt* a, int precision, T81Complex* result);
 TritError tritjs_sin_complex(T81BigInt* a, int precision, T81Complex* result);
 TritError tritjs_cos_complex(T81BigInt* a, int precision, T81Complex* result);
 TritError tritjs_tan_complex(T81BigInt* a, int precision, T81Complex* result);
 TritError tritjs_pi(int* len, int** pi);
+TritError tritjs_pi_n(int trits, int* len, int** pi);
+void tritjs_float_free(T81Float* f);
+void tritjs_complex_free(T81Complex* c);
+void tritjs_bench_scientific(FILE *out);
+TritError tritjs_const_pi(int precision, T81Float* out);
+TritError tritjs_const_e(int precision, T81Float* out);
+TritError tritjs_const_ln3(int precision, T81Float* out);
+void tritjs_const_cache_clear(void);
+void tritjs_bench_constants(FILE *out, int trits);
 TritError parse_trit_string(const char* s, T81BigInt** out);
+TritError tritjs_parse_decimal(const char* s, T81BigInt** out);
 TritError t81bigint_to_trit_string(const T81BigInt* in, char** out);
 TritError binary_to_trit(int num, T81BigInt** out);
 TritError trit_to_binary(T81BigInt* x, int* outVal);
 void tritbig_free(T81BigInt* x);
 TritError parse_balanced_trit_string(const char* s, T81BigInt** out);
+TritError tritjs_planes_from_big(const T81BigInt* x, T81TritPlanes* out);
+TritError tritjs_planes_to_big(const T81TritPlanes* x, T81BigInt** out);
+TritError tritjs_planes_and(const T81TritPlanes* a, const T81TritPlanes* b, T81TritPlanes* out);
+TritError tritjs_planes_or(const T81TritPlanes* a, const T81TritPlanes* b, T81TritPlanes* out);
+TritError tritjs_planes_xor(const T81TritPlanes* a, const T81TritPlanes* b, T81TritPlanes* out);
+TritError tritjs_planes_not(const T81TritPlanes* a, T81TritPlanes* out);
+void tritjs_planes_free(T81TritPlanes* x);
+TritError tritjs_batch_reserve(T81Batch* b, size_t n, size_t limbs);
+TritError tritjs_batch_push(T81Batch* b, const T81BigInt* x);
+TritError tritjs_batch_get(const T81Batch* b, size_t i, T81BigInt** out);
+TritError tritjs_batch_from_int64(const int64_t* v, size_t n, T81Batch* out);
+TritError tritjs_batch_to_int64(const T81Batch* b, int64_t* out);
+TritError tritjs_batch_add(const T81Batch* a, const T81Batch* b, T81Batch* out);
+TritError tritjs_batch_sub(const T81Batch* a, const T81Batch* b, T81Batch* out);
+TritError tritjs_batch_mul(const T81Batch* a, const T81Batch* b, T81Batch* out);
+TritError tritjs_batch_compare(const T81Batch* a, const T81Batch* b, int* out);
+void tritjs_batch_free(T81Batch* b);
+void tritjs_bench_batch(FILE *out, size_t n);
+int tritjs_self_check(FILE *out);
 
 /* --- Logging and Error Handling --- */
 static const char* trit_error_str(TritError err) {
@@ -172,58 +360,401 @@ static const char* trit_error_str(TritError err) {
 }
 
 static void log_error(TritError err, const char* context, const char* file, int line) {
-    if (!audit_log) return;
+    T81Context *ctx = t81_ctx();
+    FILE *log = ctx->log ? ctx->log : audit_log;
+    __atomic_add_fetch(&ctx->errors, 1, __ATOMIC_RELAXED);
+    if (!log) return;
     time_t now;
+    char when[26];
     time(&now);
-    fprintf(audit_log, "[%s] ERROR %d: %s in %s (%s:%d)\n",
-            ctime(&now), err, trit_error_str(err), context, file, line);
-    fflush(audit_log);
+    fprintf(log, "[%s] ERROR %d: %s in %s (%s:%d)\n",
+            ctime_r(&now, when), err, trit_error_str(err), context, file, line);
+    fflush(log);
+}
+
+/* --- Tuning Configuration --- */
+/* The tuning file holds `key = value` lines, in limbs except the *_bytes keys.
+   Lines that do not parse (including '#' comments) and unknown keys are
+   skipped, and values below a key's minimum keep the current setting.
+   The file is $TRITJS_TUNE_FILE if set, else $HOME/.tritjs_tune, and is
+   read once, on first use of the arithmetic. Keys marked ctx can also be
+   set per context; the rest describe the machine and are process-wide. */
+static const struct {
+    const char *key;
+    size_t *val;
+    size_t min;
+    int ctx;
+} t81_tuning_keys[] = {
+    { "mmap_bytes", &t81_tuning.mmap_bytes, 0, 1 },
+    { "mul_cache_bytes", &t81_tuning.mul_cache_bytes, 0, 1 },
+    { "karatsuba", &t81_tuning.karatsuba, 3, 0 },
+    { "toom3", &t81_tuning.toom3, 1, 0 },
+    { "toom4", &t81_tuning.toom4, 1, 0 },
+    { "ntt", &t81_tuning.ntt, 1, 0 },
+    { "div_dc", &t81_tuning.div_dc, 4, 0 },
+    { "div_newton", &t81_tuning.div_newton, 2, 0 },
+    { "threads", &t81_tuning.threads, 0, 1 },
+    { "map_backend", &t81_tuning.map_backend, 0, 1 },
+    { "par_mul", &t81_tuning.par_mul, 1, 0 },
+};
+#define T81_TUNING_KEYS (sizeof(t81_tuning_keys) / sizeof(t81_tuning_keys[0]))
+
+static pthread_once_t t81_tuning_once = PTHREAD_ONCE_INIT;
+
+static const char* t81_tuning_path(char *buf, size_t n) {
+    const char *p = getenv("TRITJS_TUNE_FILE");
+    if (p && *p) return p;
+    const char *home = getenv("HOME");
+    if (!home || !*home) return NULL;
+    snprintf(buf, n, "%s/.tritjs_tune", home);
+    return buf;
+}
+
+static TritError t81_tuning_read(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 2;
+    char line[256], key[32];
+    unsigned long long v;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, " %31[a-z0-9_] = %llu", key, &v) != 2) continue;
+        for (size_t i = 0; i < T81_TUNING_KEYS; i++)
+            if (strcmp(key, t81_tuning_keys[i].key) == 0 && v >= t81_tuning_keys[i].min)
+                *t81_tuning_keys[i].val = (size_t)v;
+    }
+    fclose(f);
+    return 0;
+}
+
+static void t81_tuning_load_default(void) {
+    char buf[512];
+    const char *path = t81_tuning_path(buf, sizeof(buf));
+    if (path) t81_tuning_read(path);
+}
+
+static void t81_tuning_init(void) {
+    pthread_once(&t81_tuning_once, t81_tuning_load_default);
+}
+
+/* Threads a parallel computation may use: the context's threads key, or
+   every online CPU when it is 0. */
+static size_t t81_thread_count(void) {
+    t81_tuning_init();
+    size_t threads = t81_ctx()->tuning->threads;
+    if (threads) return threads;
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t)n : 1;
+}
+
+/* Applies the cutoffs in path on top of the current ones. */
+TritError tritjs_load_tuning(const char *path) {
+    if (!path) return 2;
+    t81_tuning_init();
+    return t81_tuning_read(path);
+}
+
+TritError tritjs_save_tuning(const char *path) {
+    if (!path) return 2;
+    FILE *f = fopen(path, "w");
+    if (!f) return 2;
+    fprintf(f, "# tritjs %s tuning, written by `tritjs --tune`\n", VERSION);
+    for (size_t i = 0; i < T81_TUNING_KEYS; i++)
+        fprintf(f, "%s = %zu\n", t81_tuning_keys[i].key, *t81_tuning_keys[i].val);
+    return fclose(f) == 0 ? 0 : 2;
 }
 
 /* --- Memory Management --- */
-static TritError allocate_digits(T81BigInt *x, size_t lengthNeeded) {
-    size_t bytesNeeded = (lengthNeeded == 0 ? 1 : lengthNeeded);
-    x->len = lengthNeeded;
+/* Buffers of mmap_bytes or more are mapped rather than taken from the
+   heap. The map_backend key picks anonymous memory (the default), a
+   memfd, or, as an explicit spill mode, an unlinked file under
+   $TRITJS_SPILL_DIR (default /tmp) that the kernel may write back to
+   disk. Mappings of a huge page or more are aligned to one, and the two
+   memory backends ask for transparent huge pages, so a large operand
+   faults in 2 MiB at a time instead of 4 KiB. */
+enum { T81_MAP_ANON, T81_MAP_MEMFD, T81_MAP_FILE, T81_MAP_BACKENDS };
+static const char *const t81_map_names[T81_MAP_BACKENDS] = { "anon", "memfd", "file" };
+
+static int t81_map_backend(void) {
+    t81_tuning_init();
+    size_t b = t81_ctx()->tuning->map_backend;
+    return b < T81_MAP_BACKENDS ? (int)b : T81_MAP_ANON;
+}
+
+static size_t t81_page_round(size_t bytes) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return (bytes + page - 1) / page * page;
+}
+
+/* Maps at least *bytes of zeroed memory from backend *kind and returns
+   it, or NULL. On success *bytes is the mapped length and *kind the
+   backend used: a memfd falls back to anonymous memory on kernels
+   without memfd_create. */
+static void* t81_map(size_t *bytes, int *kind) {
+    size_t len = t81_page_round(*bytes);
+    size_t pad = len >= T81_HUGE_PAGE ? T81_HUGE_PAGE : 0;
+    int fd = -1;
+    if (*kind == T81_MAP_MEMFD) {
+#ifdef MFD_CLOEXEC
+        fd = memfd_create("tritjs", MFD_CLOEXEC);
+#endif
+        if (fd < 0) *kind = T81_MAP_ANON;
+    } else if (*kind == T81_MAP_FILE) {
+        const char *dir = getenv("TRITJS_SPILL_DIR");
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/tritjs_cisa_XXXXXX", dir && *dir ? dir : "/tmp");
+        fd = mkstemp(path);
+        if (fd < 0) return NULL;
+        unlink(path);
+    }
+    if (fd >= 0 && ftruncate(fd, (off_t)len) < 0) {
+        close(fd);
+        return NULL;
+    }
+    /* Over-reserve by a huge page, trim to an aligned window and map any
+       file over it; the mapping keeps the file alive after close. */
+    char *base = mmap(NULL, len + pad, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        if (fd >= 0) close(fd);
+        return NULL;
+    }
+    char *p = pad ? (char*)(((uintptr_t)base + pad - 1) & ~(uintptr_t)(pad - 1)) : base;
+    if (p > base) munmap(base, (size_t)(p - base));
+    if (base + pad > p) munmap(p + len, (size_t)(base + pad - p));
+    if (fd >= 0) {
+        void *f = mmap(p, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+        close(fd);
+        if (f == MAP_FAILED) {
+            munmap(p, len);
+            return NULL;
+        }
+    }
+#ifdef MADV_HUGEPAGE
+    if (pad && *kind != T81_MAP_FILE) madvise(p, len, MADV_HUGEPAGE);
+#endif
+    *bytes = len;
+    T81Context *ctx = t81_ctx();
+    __atomic_add_fetch(&ctx->maps, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&ctx->mapped_bytes, len, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&total_mapped_bytes, (long)len, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&operation_steps, 1, __ATOMIC_RELAXED);
+    return p;
+}
+
+static void t81_unmap(void *p, size_t bytes) {
+    munmap(p, bytes);
+    __atomic_add_fetch(&t81_ctx()->unmaps, 1, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&total_mapped_bytes, (long)bytes, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&operation_steps, 1, __ATOMIC_RELAXED);
+}
+
+/* Selects the current context's backend for later large buffers by name
+   ("anon", "memfd" or "file"); buffers already mapped keep theirs. */
+TritError tritjs_set_map_backend(const char *name) {
+    if (!name) return 2;
+    for (int i = 0; i < T81_MAP_BACKENDS; i++)
+        if (strcmp(name, t81_map_names[i]) == 0) {
+            t81_tuning_init();
+            t81_ctx()->tuning->map_backend = (size_t)i;
+            return 0;
+        }
+    return 2;
+}
+
+static inline int t81bigint_is_inline(const T81BigInt *x) {
+    return x->limbs == x->inl;
+}
+
+/* Obtains zeroed storage for at least `capacity` limbs for x: its inline
+   limbs when they suffice, else a buffer on the heap below the mmap
+   threshold and mapped above it, where the capacity is rounded up to
+   whole pages. Leaves len and sign alone. */
+static TritError t81_alloc_limbs(T81BigInt *x, size_t capacity) {
+    size_t bytes = capacity * sizeof(T81Limb);
+    t81_tuning_init();
+    x->capacity = 0;
+    x->is_mapped = 0;
+    if (capacity <= T81_INLINE_LIMBS) {
+        memset(x->inl, 0, sizeof(x->inl));
+        x->limbs = x->inl;
+        x->capacity = T81_INLINE_LIMBS;
+        return 0;
+    }
+    if (bytes < t81_ctx()->tuning->mmap_bytes) {
+        x->limbs = (T81Limb*)calloc(bytes, 1);
+        if (!x->limbs) return 1;
+        x->capacity = capacity;
+        return 0;
+    }
+    int kind = t81_map_backend();
+    x->limbs = t81_map(&bytes, &kind);
+    if (!x->limbs) return 8;
+    x->is_mapped = 1 + kind;
+    x->capacity = bytes / sizeof(T81Limb);
+    return 0;
+}
+
+/* Frees x's storage, or just drops x's hold on it while other values
+   share it. */
+static void t81_release_limbs(T81BigInt *x) {
+    int last = 1;
+    if (x->refs) {
+        last = __atomic_sub_fetch(x->refs, 1, __ATOMIC_ACQ_REL) == 0;
+        if (last) free(x->refs);
+        x->refs = NULL;
+    }
+    if (!last)
+        ;
+    else if (x->is_mapped && x->limbs)
+        t81_unmap(x->limbs, x->capacity * sizeof(T81Limb));
+    else if (!t81bigint_is_inline(x))
+        free(x->limbs);
+    x->limbs = NULL;
+    x->capacity = 0;
     x->is_mapped = 0;
-    x->fd = -1;
-    if (bytesNeeded < T81_MMAP_THRESHOLD) {
-        x->digits = (unsigned char*)calloc(bytesNeeded, 1);
-        if (!x->digits) return 1;
+}
+
+/* Gives x, whose buffer is shared, a private one of at least n limbs
+   holding its value. The last holder simply keeps the buffer. */
+static TritError t81bigint_unshare(T81BigInt *x, size_t n) {
+    if (__atomic_load_n(x->refs, __ATOMIC_ACQUIRE) == 1) {
+        free(x->refs);
+        x->refs = NULL;
         return 0;
     }
-    strcpy(x->tmp_path, "/tmp/tritjs_cisa_XXXXXX");
-    x->fd = mkstemp(x->tmp_path);
-    if (x->fd < 0) return 8;
-    if (ftruncate(x->fd, bytesNeeded) < 0) {
-        close(x->fd);
-        return 8;
-    }
-    x->digits = mmap(NULL, bytesNeeded, PROT_READ | PROT_WRITE, MAP_SHARED, x->fd, 0);
-    if (x->digits == MAP_FAILED) {
-        close(x->fd);
-        return 8;
-    }
-    unlink(x->tmp_path);
-    x->is_mapped = 1;
-    total_mapped_bytes += bytesNeeded;
-    operation_steps++;
+    /* Shared buffers are never inline, so the struct copy is safe. */
+    T81BigInt old = *x;
+    x->refs = NULL;
+    TritError e = t81_alloc_limbs(x, n > x->len ? n : x->len);
+    if (e) {
+        x->limbs = old.limbs;
+        x->capacity = old.capacity;
+        x->is_mapped = old.is_mapped;
+        x->refs = old.refs;
+        return e;
+    }
+    memcpy(x->limbs, old.limbs, old.len * sizeof(T81Limb));
+    t81_release_limbs(&old);
+    return 0;
+}
+
+/* Grows x to hold at least n limbs, preserving its first len limbs, and
+   makes its buffer private. Capacity at least doubles on each growth, so
+   repeated appends and accumulation loops settle into a steady buffer
+   after a few steps. */
+static TritError t81bigint_reserve(T81BigInt *x, size_t n) {
+    if (x->refs) {
+        TritError e = t81bigint_unshare(x, n);
+        if (e) return e;
+    }
+    if (n <= x->capacity) return 0;
+    size_t cap = x->capacity * 2;
+    if (cap < n) cap = n;
+    if (x->capacity == 0) return t81_alloc_limbs(x, cap);
+    if (!x->is_mapped && !t81bigint_is_inline(x) && cap * sizeof(T81Limb) < t81_ctx()->tuning->mmap_bytes) {
+        T81Limb *grown = realloc(x->limbs, cap * sizeof(T81Limb));
+        if (!grown) return 1;
+        memset(grown + x->capacity, 0, (cap - x->capacity) * sizeof(T81Limb));
+        x->limbs = grown;
+        x->capacity = cap;
+        return 0;
+    }
+#if defined(MREMAP_MAYMOVE) && !defined(__SANITIZE_THREAD__)
+    /* Anonymous pages move without a copy or fresh faults. ThreadSanitizer
+       does not follow mremap, so its builds take the copy below. */
+    if (x->is_mapped == 1 + T81_MAP_ANON) {
+        size_t old = x->capacity * sizeof(T81Limb), bytes = t81_page_round(cap * sizeof(T81Limb));
+        void *p = mremap(x->limbs, old, bytes, MREMAP_MAYMOVE);
+        if (p != MAP_FAILED) {
+#ifdef MADV_HUGEPAGE
+            if (bytes >= T81_HUGE_PAGE) madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+            __atomic_add_fetch(&t81_ctx()->mapped_bytes, bytes - old, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&total_mapped_bytes, (long)(bytes - old), __ATOMIC_RELAXED);
+            x->limbs = p;
+            x->capacity = bytes / sizeof(T81Limb);
+            return 0;
+        }
+    }
+#endif
+    T81BigInt fresh;
+    memset(&fresh, 0, sizeof(fresh));
+    TritError e = t81_alloc_limbs(&fresh, cap);
+    if (e) return e;
+    if (x->limbs && x->len)
+        memcpy(fresh.limbs, x->limbs, (x->len < cap ? x->len : cap) * sizeof(T81Limb));
+    t81_release_limbs(x);
+    x->limbs = fresh.limbs;
+    x->capacity = fresh.capacity;
+    x->is_mapped = fresh.is_mapped;
+    return 0;
+}
+
+/* Sizes x to lengthNeeded zeroed limbs. x must be zeroed or hold a live
+   value; an existing buffer is reused when it is large enough. */
+static TritError allocate_digits(T81BigInt *x, size_t lengthNeeded) {
+    size_t n = (lengthNeeded == 0 ? 1 : lengthNeeded);
+    if (x->refs) t81_release_limbs(x);
+    TritError e = (x->capacity == 0) ? t81_alloc_limbs(x, n) : t81bigint_reserve(x, n);
+    if (e) return e;
+    memset(x->limbs, 0, n * sizeof(T81Limb));
+    x->len = lengthNeeded;
     return 0;
 }
 
 static void t81bigint_free(T81BigInt* x) {
     if (!x) return;
-    if (x->is_mapped && x->digits && x->digits != MAP_FAILED) {
-        size_t bytes = (x->len == 0 ? 1 : x->len);
-        munmap(x->digits, bytes);
-        close(x->fd);
-        total_mapped_bytes -= bytes;
-        operation_steps++;
-    } else {
-        free(x->digits);
-    }
+    t81_release_limbs(x);
     memset(x, 0, sizeof(*x));
 }
 
+/* Exchanges the values of a and b, moving inline limbs with them. */
+static void t81bigint_swap(T81BigInt *a, T81BigInt *b) {
+    T81BigInt t = *a;
+    *a = *b;
+    *b = t;
+    if (a->limbs == b->inl) a->limbs = a->inl;
+    if (b->limbs == a->inl) b->limbs = b->inl;
+}
+
+/* Copies src's value into dst, reusing dst's buffer when it is large enough. */
+static TritError t81bigint_assign(T81BigInt* dst, const T81BigInt* src) {
+    if (dst == src) return 0;
+    if (t81bigint_reserve(dst, src->len)) return 1;
+    memcpy(dst->limbs, src->limbs, src->len * sizeof(T81Limb));
+    dst->len = src->len;
+    dst->sign = src->sign;
+    return 0;
+}
+
+/* Makes dst hold src's value on src's buffer, counting holders from here
+   on; inline values are copied instead. src gains its count on first
+   share, so two threads must not share from the same value at once. */
+static TritError t81bigint_share(T81BigInt *dst, T81BigInt *src) {
+    if (dst == src) return 0;
+    if (!src->limbs || t81bigint_is_inline(src)) return t81bigint_assign(dst, src);
+    if (!src->refs) {
+        src->refs = (unsigned long*)malloc(sizeof(*src->refs));
+        if (!src->refs) return 1;
+        *src->refs = 1;
+    }
+    __atomic_add_fetch(src->refs, 1, __ATOMIC_RELAXED);
+    t81_release_limbs(dst);
+    dst->limbs = src->limbs;
+    dst->capacity = src->capacity;
+    dst->is_mapped = src->is_mapped;
+    dst->refs = src->refs;
+    dst->len = src->len;
+    dst->sign = src->sign;
+    return 0;
+}
+
+/* Drops leading zero limbs; zero is always stored as a positive single limb. */
+static void t81bigint_normalize(T81BigInt* x) {
+    while (x->len > 1 && x->limbs[x->len - 1] == 0)
+        x->len--;
+    if (x->len == 1 && x->limbs[0] == 0)
+        x->sign = 0;
+}
+
 /* --- Audit Logging --- */
 static void init_audit_log() {
     audit_log = fopen("/var/log/tritjs_cisa.log", "a");
@@ -235,7 +766,255 @@ static void init_audit_log() {
     }
 }
 
+/* --- Limb Primitives --- */
+/* Divides hi*2^64 + lo by 3^40 (requires hi < 3^40) using the precomputed
+   reciprocal, so the hot loops never reach a 128-bit hardware divide. */
+static inline T81Limb t81_limb_divmod(T81Limb hi, T81Limb lo, T81Limb *rem) {
+    T81DLimb q = (T81DLimb)T81_LIMB_BASE_INV * hi;
+    q += ((T81DLimb)(hi + 1) << 64) | lo;
+    T81Limb q1 = (T81Limb)(q >> 64), q0 = (T81Limb)q;
+    T81Limb r = lo - q1 * T81_LIMB_BASE;
+    if (r > q0) { q1--; r += T81_LIMB_BASE; }
+    if (r >= T81_LIMB_BASE) { q1++; r -= T81_LIMB_BASE; }
+    *rem = r;
+    return q1;
+}
+
+static inline T81Limb t81_limb_split(T81DLimb t, T81Limb *rem) {
+    return t81_limb_divmod((T81Limb)(t >> 64), (T81Limb)t, rem);
+}
+
+/* Whether the running CPU has AVX2, for kernels picked at run time. */
+static inline int t81_have_avx2(void) {
+#if defined(__x86_64__)
+    return __builtin_cpu_supports("avx2");
+#else
+    return 0;
+#endif
+}
+
+/* Sums and differences with the carry (borrow) chain resolved 64 limbs at
+   a time: the lane-wise pass records which limbs generate a carry (g) and
+   which would pass one on (p: the limb is 3^40 - 1, or 0 when
+   subtracting), and since no limb does both, the carries into the block
+   are ((g << 1 | cin) + p) ^ p, one 64-bit add. A second pass applies
+   them. Shorter runs stay on the scalar loops. */
+#define T81_ADD_SIMD_MIN 64
+
+static T81Limb limbs_add_nc(T81Limb *r, const T81Limb *a, const T81Limb *b, size_t n, T81Limb carry) {
+    for (size_t i = 0; i < n; i++) {
+        T81Limb s = a[i] + carry;
+        T81Limb t = T81_LIMB_BASE - b[i];
+        if (s >= t) { r[i] = s - t; carry = 1; }
+        else { r[i] = s + b[i]; carry = 0; }
+    }
+    return carry;
+}
+
+static T81Limb limbs_sub_nc(T81Limb *r, const T81Limb *a, const T81Limb *b, size_t n, T81Limb borrow) {
+    for (size_t i = 0; i < n; i++) {
+        T81Limb s = b[i] + borrow;
+        if (a[i] >= s) { r[i] = a[i] - s; borrow = 0; }
+        else { r[i] = a[i] + (T81_LIMB_BASE - s); borrow = 1; }
+    }
+    return borrow;
+}
+
+#if defined(__x86_64__)
+/* Lane masks for the 16 carry patterns of a 4-limb group. */
+static const int64_t t81_lane_masks[16][4] __attribute__((aligned(32))) = {
+    { 0, 0, 0, 0 }, { -1, 0, 0, 0 }, { 0, -1, 0, 0 }, { -1, -1, 0, 0 },
+    { 0, 0, -1, 0 }, { -1, 0, -1, 0 }, { 0, -1, -1, 0 }, { -1, -1, -1, 0 },
+    { 0, 0, 0, -1 }, { -1, 0, 0, -1 }, { 0, -1, 0, -1 }, { -1, -1, 0, -1 },
+    { 0, 0, -1, -1 }, { -1, 0, -1, -1 }, { 0, -1, -1, -1 }, { -1, -1, -1, -1 },
+};
+
+/* AVX2 has only signed 64-bit compares; limbs reach 3^40 > 2^63, so both
+   sides are biased by 2^63 first. */
+__attribute__((target("avx2")))
+static T81Limb limbs_addsub_avx2(int sub, T81Limb *r, const T81Limb *a, const T81Limb *b, size_t n, T81Limb c) {
+    const __m256i base = _mm256_set1_epi64x((long long)T81_LIMB_BASE);
+    const __m256i bias = _mm256_set1_epi64x((long long)(1ULL << 63));
+    const __m256i top = _mm256_set1_epi64x((long long)(T81_LIMB_BASE - 1));
+    const __m256i ones = _mm256_set1_epi64x(-1);
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        uint64_t g = 0, p = 0;
+        for (int k = 0; k < 64; k += 4) {
+            __m256i x = _mm256_loadu_si256((const __m256i*)(a + i + k));
+            __m256i y = _mm256_loadu_si256((const __m256i*)(b + i + k));
+            __m256i gen, z;
+            if (sub) {
+                /* a < b borrows: z = a - b + 3^40. */
+                gen = _mm256_cmpgt_epi64(_mm256_xor_si256(y, bias), _mm256_xor_si256(x, bias));
+                z = _mm256_add_epi64(_mm256_sub_epi64(x, y), _mm256_and_si256(gen, base));
+                p |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(
+                         _mm256_cmpeq_epi64(z, _mm256_setzero_si256()))) << k;
+            } else {
+                /* a >= 3^40 - b carries: z = a + b - 3^40, modulo 2^64. */
+                __m256i t = _mm256_sub_epi64(base, y);
+                gen = _mm256_xor_si256(_mm256_cmpgt_epi64(_mm256_xor_si256(t, bias),
+                                                          _mm256_xor_si256(x, bias)), ones);
+                z = _mm256_sub_epi64(_mm256_add_epi64(x, y), _mm256_and_si256(gen, base));
+                p |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(z, top))) << k;
+            }
+            g |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(gen)) << k;
+            _mm256_storeu_si256((__m256i*)(r + i + k), z);
+        }
+        uint64_t gs = (g << 1) | c;
+        uint64_t sum = gs + p;
+        uint64_t in = sum ^ p;
+        c = (g >> 63) | (sum < p);
+        for (int k = 0; in && k < 64; k += 4, in >>= 4) {
+            __m256i m = _mm256_load_si256((const __m256i*)t81_lane_masks[in & 15]);
+            __m256i z = _mm256_loadu_si256((const __m256i*)(r + i + k));
+            if (sub) {
+                /* 0 - 1 wraps to 2^64 - 1; adding 3^40 leaves 3^40 - 1. */
+                z = _mm256_add_epi64(z, m);
+                z = _mm256_add_epi64(z, _mm256_and_si256(_mm256_cmpeq_epi64(z, ones), base));
+            } else {
+                z = _mm256_sub_epi64(z, m);
+                z = _mm256_andnot_si256(_mm256_cmpeq_epi64(z, base), z);
+            }
+            _mm256_storeu_si256((__m256i*)(r + i + k), z);
+        }
+    }
+    return sub ? limbs_sub_nc(r + i, a + i, b + i, n - i, c)
+               : limbs_add_nc(r + i, a + i, b + i, n - i, c);
+}
+#endif
+
+/* r = a + b over n limbs; returns the carry (0 or 1). r may alias a or b.
+   2 * 3^40 overflows 64 bits, so sums are compared against 3^40 - b. */
+static T81Limb limbs_add_n(T81Limb *r, const T81Limb *a, const T81Limb *b, size_t n) {
+#if defined(__x86_64__)
+    if (n >= T81_ADD_SIMD_MIN && t81_have_avx2()) return limbs_addsub_avx2(0, r, a, b, n, 0);
+#endif
+    return limbs_add_nc(r, a, b, n, 0);
+}
+
+/* r = a + carry over n limbs, for any carry below 3^40. */
+static T81Limb limbs_add_1(T81Limb *r, const T81Limb *a, size_t n, T81Limb carry) {
+    size_t i = 0;
+    for (; i < n && carry; i++) {
+        T81Limb t = T81_LIMB_BASE - carry;
+        if (a[i] >= t) { r[i] = a[i] - t; carry = 1; }
+        else { r[i] = a[i] + carry; carry = 0; }
+    }
+    if (r != a && i < n) memcpy(r + i, a + i, (n - i) * sizeof(T81Limb));
+    return carry;
+}
+
+/* r = a - b over n limbs; returns the borrow (0 or 1). r may alias a or b. */
+static T81Limb limbs_sub_n(T81Limb *r, const T81Limb *a, const T81Limb *b, size_t n) {
+#if defined(__x86_64__)
+    if (n >= T81_ADD_SIMD_MIN && t81_have_avx2()) return limbs_addsub_avx2(1, r, a, b, n, 0);
+#endif
+    return limbs_sub_nc(r, a, b, n, 0);
+}
+
+static T81Limb limbs_sub_1(T81Limb *r, const T81Limb *a, size_t n, T81Limb borrow) {
+    size_t i = 0;
+    for (; i < n && borrow; i++) {
+        if (a[i] >= borrow) { r[i] = a[i] - borrow; borrow = 0; }
+        else { r[i] = a[i] + (T81_LIMB_BASE - borrow); borrow = 1; }
+    }
+    if (r != a && i < n) memcpy(r + i, a + i, (n - i) * sizeof(T81Limb));
+    return borrow;
+}
+
+/* r = a * m over n limbs (m < 3^40); returns the high limb. */
+static T81Limb limbs_mul_1(T81Limb *r, const T81Limb *a, size_t n, T81Limb m) {
+    T81Limb carry = 0;
+    for (size_t i = 0; i < n; i++) {
+        T81DLimb t = (T81DLimb)a[i] * m + carry;
+        carry = t81_limb_split(t, &r[i]);
+    }
+    return carry;
+}
+
+/* r += a * m over n limbs; returns the high limb. */
+static T81Limb limbs_addmul_1(T81Limb *r, const T81Limb *a, size_t n, T81Limb m) {
+    T81Limb carry = 0;
+    for (size_t i = 0; i < n; i++) {
+        T81DLimb t = (T81DLimb)a[i] * m + r[i] + carry;
+        carry = t81_limb_split(t, &r[i]);
+    }
+    return carry;
+}
+
+/* r -= a * m over n limbs; returns the limb still to be subtracted from
+   r[n]. a * m + carry never exceeds (3^40)^2 - 3^40, so the borrow can be
+   folded into the high limb without overflowing it. */
+static T81Limb limbs_submul_1(T81Limb *r, const T81Limb *a, size_t n, T81Limb m) {
+    T81Limb carry = 0;
+    for (size_t i = 0; i < n; i++) {
+        T81Limb lo;
+        T81Limb hi = t81_limb_split((T81DLimb)a[i] * m + carry, &lo);
+        if (r[i] >= lo) { r[i] -= lo; carry = hi; }
+        else { r[i] += T81_LIMB_BASE - lo; carry = hi + 1; }
+    }
+    return carry;
+}
+
+/* q = a / d for a small divisor (d < 2^32); returns the remainder. With
+   3^40 = d*qb + rb, each step splits rem*3^40 + a[i] so that only 64-bit
+   divisions are needed, which the compiler folds when d is a constant. */
+static inline T81Limb limbs_divrem_small(T81Limb *q, const T81Limb *a, size_t n, T81Limb d) {
+    T81Limb qb = T81_LIMB_BASE / d, rb = T81_LIMB_BASE % d;
+    T81Limb rem = 0;
+    for (size_t i = n; i-- > 0;) {
+        T81Limb u = rem * rb + a[i] % d;
+        q[i] = rem * qb + a[i] / d + u / d;
+        rem = u % d;
+    }
+    return rem;
+}
+
+/* q = a / d over n limbs (0 < d < 3^40); returns the remainder. q may alias a. */
+static T81Limb limbs_divrem_1(T81Limb *q, const T81Limb *a, size_t n, T81Limb d) {
+    if (d <= UINT32_MAX) return limbs_divrem_small(q, a, n, d);
+    T81Limb rem = 0;
+    for (size_t i = n; i-- > 0;) {
+        T81DLimb t = (T81DLimb)rem * T81_LIMB_BASE + a[i];
+        q[i] = (T81Limb)(t / d);
+        rem = (T81Limb)(t % d);
+    }
+    return rem;
+}
+
+static int cmp_limbs(const T81Limb* a, size_t a_len,
+                     const T81Limb* b, size_t b_len) {
+    while (a_len > 0 && a[a_len - 1] == 0) a_len--;
+    while (b_len > 0 && b[b_len - 1] == 0) b_len--;
+    if (a_len != b_len) return a_len > b_len ? 1 : -1;
+    for (size_t i = a_len; i-- > 0;) {
+        if (a[i] < b[i]) return -1;
+        if (a[i] > b[i]) return 1;
+    }
+    return 0;
+}
+
+/* 3^k for 0 <= k <= 40. */
+static T81Limb t81_pow3(int k) {
+    T81Limb p = 1;
+    while (k-- > 0) p *= 3;
+    return p;
+}
+
+/* Returns k when the n-limb x is 3^k, else -1. */
+static long t81_pow3_exponent(const T81Limb *x, size_t n) {
+    for (size_t i = 0; i + 1 < n; i++)
+        if (x[i]) return -1;
+    T81Limb top = x[n - 1];
+    long k = (long)(n - 1) * T81_LIMB_TRITS;
+    while (top % 3 == 0) { top /= 3; k++; }
+    return top == 1 ? k : -1;
+}
+
 /* --- Base Conversion and Parsing --- */
+/* Limbs are a power-of-three base, so each one covers exactly 40 characters of
+   the trit string and conversion is a single linear pass in either direction. */
 static TritError parse_trit_string_base81_optimized(const char* str, T81BigInt* out) {
     if (!str || !str[0]) return 2;
     memset(out, 0, sizeof(*out));
@@ -243,55 +1022,26 @@ static TritError parse_trit_string_base81_optimized(const char* str, T81BigInt*
     size_t pos = 0;
     if (str[0] == '-' || str[0] == '–') { sign = 1; pos = 1; }
     size_t total_len = strlen(str) - pos;
-    size_t remainder = total_len % 4;
-    if (allocate_digits(out, 1)) return 1;
-    out->digits[0] = 0;
+    size_t nlimbs = total_len / T81_LIMB_TRITS + 1;
+    TritError e = allocate_digits(out, nlimbs);
+    if (e) return e;
     out->sign = sign;
-    for (size_t i = 0; i < remainder; i++) {
-        int digit = str[pos + i] - '0';
-        if (digit < 0 || digit > 2) return 2;
-        int carry = digit;
-        for (size_t j = 0; j < out->len; j++) {
-            int val = out->digits[j] * 3 + carry;
-            out->digits[j] = val % BASE_81;
-            carry = val / BASE_81;
-        }
-        while (carry) {
-            size_t old_len = out->len;
-            TritError e = allocate_digits(out, out->len + 1);
-            if (e) return e;
-            out->digits[old_len] = carry % BASE_81;
-            carry /= BASE_81;
-        }
-    }
-    pos += remainder;
-    while (pos < strlen(str)) {
-        int groupVal = 0;
-        for (int k = 0; k < 4; k++) {
-            if (str[pos + k] < '0' || str[pos + k] > '2') return 2;
-            groupVal = groupVal * 3 + (str[pos + k] - '0');
-        }
-        pos += 4;
-        int carry = groupVal;
-        for (size_t j = 0; j < out->len; j++) {
-            int val = out->digits[j] * 81 + carry;
-            out->digits[j] = val % BASE_81;
-            carry = val / BASE_81;
-        }
-        while (carry) {
-            size_t old_len = out->len;
-            TritError e = allocate_digits(out, out->len + 1);
-            if (e) return e;
-            out->digits[old_len] = carry % BASE_81;
-            carry /= BASE_81;
-        }
-    }
-    while (out->len > 1 && out->digits[out->len - 1] == 0)
-        out->len--;
+    for (size_t i = 0; i * T81_LIMB_TRITS < total_len; i++) {
+        size_t stop = total_len - i * T81_LIMB_TRITS;
+        size_t start = (stop > T81_LIMB_TRITS) ? stop - T81_LIMB_TRITS : 0;
+        T81Limb v = 0;
+        for (size_t k = start; k < stop; k++) {
+            int digit = str[pos + k] - '0';
+            if (digit < 0 || digit > 2) { t81bigint_free(out); return 2; }
+            v = v * 3 + (T81Limb)digit;
+        }
+        out->limbs[i] = v;
+    }
+    t81bigint_normalize(out);
     return 0;
 }
 
-static TritError parse_trit_string(const char* s, T81BigInt** out) {
+TritError parse_trit_string(const char* s, T81BigInt** out) {
     if (!out) return 1;
     *out = (T81BigInt*)calloc(1, sizeof(T81BigInt));
     if (!*out) return 1;
@@ -300,84 +1050,68 @@ static TritError parse_trit_string(const char* s, T81BigInt** out) {
     return e;
 }
 
-static TritError t81bigint_to_trit_string(const T81BigInt* in, char** out) {
+/* The four trits of each base-81 digit, most significant first. */
+static const char t81_digit_trits[81 * 4 + 1] =
+    "0000" "0001" "0002" "0010" "0011" "0012" "0020" "0021" "0022"
+    "0100" "0101" "0102" "0110" "0111" "0112" "0120" "0121" "0122"
+    "0200" "0201" "0202" "0210" "0211" "0212" "0220" "0221" "0222"
+    "1000" "1001" "1002" "1010" "1011" "1012" "1020" "1021" "1022"
+    "1100" "1101" "1102" "1110" "1111" "1112" "1120" "1121" "1122"
+    "1200" "1201" "1202" "1210" "1211" "1212" "1220" "1221" "1222"
+    "2000" "2001" "2002" "2010" "2011" "2012" "2020" "2021" "2022"
+    "2100" "2101" "2102" "2110" "2111" "2112" "2120" "2121" "2122"
+    "2200" "2201" "2202" "2210" "2211" "2212" "2220" "2221" "2222";
+
+/* Sizes the string up front and fills it in one backwards pass: every limb
+   below the top expands to exactly ten table entries, and only the top
+   limb is written trit by trit to drop its leading zeros. */
+TritError t81bigint_to_trit_string(const T81BigInt* in, char** out) {
     if (!in || !out) return 2;
-    if (in->len == 1 && in->digits[0] == 0) {
+    size_t len = in->len;
+    while (len > 1 && in->limbs[len - 1] == 0) len--;
+    if (len == 0 || (len == 1 && in->limbs[0] == 0)) {
         *out = strdup("0");
-        return 0;
+        return *out ? 0 : 1;
+    }
+    T81Limb top = in->limbs[len - 1];
+    size_t top_trits = 0;
+    for (T81Limb v = top; v; v /= 3) top_trits++;
+    size_t total = (len - 1) * T81_LIMB_TRITS + top_trits + (in->sign ? 1 : 0);
+    char* buf = malloc(total + 1);
+    if (!buf) return 1;
+    char* p = buf + total;
+    *p = '\0';
+    for (size_t i = 0; i + 1 < len; i++) {
+        T81Limb v = in->limbs[i];
+        for (int k = 0; k < T81_LIMB_DIGITS81; k++, v /= BASE_81) {
+            p -= 4;
+            memcpy(p, t81_digit_trits + 4 * (v % BASE_81), 4);
+        }
     }
-    T81BigInt tmp = *in;
-    T81BigInt tmpCopy;
-    memset(&tmpCopy, 0, sizeof(tmpCopy));
-    if (allocate_digits(&tmpCopy, tmp.len)) return 1;
-    tmpCopy.len = tmp.len;
-    memcpy(tmpCopy.digits, tmp.digits, tmp.len);
-    tmpCopy.sign = tmp.sign;
-    size_t capacity = tmp.len * 4 + 2;
-    char* buf = calloc(capacity, 1);
-    if (!buf) { t81bigint_free(&tmpCopy); return 1; }
-    size_t idx = 0;
-    while (1) {
-        int isZero = 1;
-        for (size_t i = 0; i < tmpCopy.len; i++) {
-            if (tmpCopy.digits[i] != 0) { isZero = 0; break; }
-        }
-        if (isZero) { if (idx == 0) buf[idx++] = '0'; break; }
-        int carry = 0;
-        for (ssize_t i = tmpCopy.len - 1; i >= 0; i--) {
-            int val = tmpCopy.digits[i] + carry * BASE_81;
-            int q = val / 3;
-            int r = val % 3;
-            tmpCopy.digits[i] = q;
-            carry = r;
-        }
-        buf[idx++] = (char)('0' + carry);
-    }
-    t81bigint_free(&tmpCopy);
-    if (in->sign) { buf[idx++] = '-'; }
-    for (size_t i = 0; i < idx / 2; i++) {
-        char t = buf[i];
-        buf[i] = buf[idx - 1 - i];
-        buf[idx - 1 - i] = t;
-    }
-    buf[idx] = '\0';
+    for (T81Limb v = top; v; v /= 3) *--p = (char)('0' + v % 3);
+    if (in->sign) *--p = '-';
     *out = buf;
     return 0;
 }
 
-static TritError binary_to_trit(int num, T81BigInt** out) {
-    char b3[128];
-    int sign = (num < 0) ? 1 : 0;
-    int val = (num < 0) ? -num : num;
-    size_t idx = 0;
-    if (val == 0) { b3[idx++] = '0'; }
-    while (val > 0) { int r = val % 3; b3[idx++] = (char)('0' + r); val /= 3; }
-    if (idx == 0) { b3[idx++] = '0'; }
-    if (sign) { b3[idx++] = '-'; }
-    for (size_t i = 0; i < idx / 2; i++) {
-        char t = b3[i];
-        b3[i] = b3[idx - 1 - i];
-        b3[idx - 1 - i] = t;
-    }
-    b3[idx] = '\0';
-    return parse_trit_string(b3, out);
-}
-
-static TritError trit_to_binary(T81BigInt* x, int* outVal) {
-    char* b3 = NULL;
-    if (t81bigint_to_trit_string(x, &b3) != 0) return 2;
-    long long accum = 0;
-    int sign = 0;
-    size_t i = 0;
-    if (b3[0] == '-') { sign = 1; i = 1; }
-    for (; b3[i]; i++) {
-        if (b3[i] < '0' || b3[i] > '2') { free(b3); return 2; }
-        accum = accum * 3 + (b3[i] - '0');
-        if (accum > INT_MAX) { free(b3); return 4; }
-    }
-    free(b3);
-    if (sign) accum = -accum;
-    *outVal = (int)accum;
+TritError binary_to_trit(int num, T81BigInt** out) {
+    if (!out) return 1;
+    *out = (T81BigInt*)calloc(1, sizeof(T81BigInt));
+    if (!*out) return 1;
+    if (allocate_digits(*out, 1)) { free(*out); *out = NULL; return 1; }
+    long long val = num;
+    (*out)->sign = (val < 0) ? 1 : 0;
+    (*out)->limbs[0] = (T81Limb)(val < 0 ? -val : val);
+    return 0;
+}
+
+TritError trit_to_binary(T81BigInt* x, int* outVal) {
+    if (!x || !outVal) return 2;
+    size_t len = x->len;
+    while (len > 1 && x->limbs[len - 1] == 0) len--;
+    if (len > 1 || x->limbs[0] > INT_MAX) return 4;
+    int val = (int)x->limbs[0];
+    *outVal = x->sign ? -val : val;
     return 0;
 }
 
@@ -400,631 +1134,4057 @@ TritError parse_balanced_trit_string(const char* s, T81BigInt** out) {
         else if (c == '+') { unb[i] = '2'; }
         else { free(unb); return 2; }
     }
-    unb[len] = '\0';
-    TritError e = parse_trit_string(unb, out);
-    free(unb);
-    return e;
+    unb[len] = '\0';
+    TritError e = parse_trit_string(unb, out);
+    free(unb);
+    return e;
+}
+
+/* --- Arithmetic Operations: Addition and Subtraction --- */
+/* r = a + b for sign-magnitude spans with signs as and bs, where r has
+   room for max(an, bn) + 1 limbs and may alias a or b. Stores the sign
+   of the result in *rs and returns its length without leading zero
+   limbs; zero comes back positive. */
+static size_t limbs_add_signed(T81Limb *r, const T81Limb *a, size_t an, int as,
+                               const T81Limb *b, size_t bn, int bs, int *rs) {
+    size_t n;
+    if (as == bs) {
+        if (an < bn) {
+            const T81Limb *t = a; a = b; b = t;
+            size_t tn = an; an = bn; bn = tn;
+        }
+        T81Limb carry = limbs_add_n(r, a, b, bn);
+        r[an] = limbs_add_1(r + bn, a + bn, an - bn, carry);
+        n = an + 1;
+    } else {
+        int c = cmp_limbs(a, an, b, bn);
+        if (c == 0) {
+            r[0] = 0;
+            *rs = 0;
+            return 1;
+        }
+        if (c < 0) {
+            const T81Limb *t = a; a = b; b = t;
+            size_t tn = an; an = bn; bn = tn;
+            as = bs;
+        }
+        /* |a| > |b| also holds for the trimmed lengths. */
+        while (bn > 1 && b[bn - 1] == 0) bn--;
+        T81Limb borrow = limbs_sub_n(r, a, b, bn);
+        limbs_sub_1(r + bn, a + bn, an - bn, borrow);
+        n = an;
+    }
+    while (n > 1 && r[n - 1] == 0) n--;
+    *rs = (n == 1 && r[0] == 0) ? 0 : as;
+    return n;
+}
+
+/* dst = A + (-1)^b_sign |B|. dst may alias A or B; its buffer is reused. */
+static TritError add_signed_into(T81BigInt* dst, const T81BigInt* A, const T81BigInt* B, int b_sign) {
+    if (A->len == 1 && B->len == 1) {
+        /* One limb each: the result is formed in registers, and fits
+           dst's inline limbs. */
+        T81Limb a = A->limbs[0], b = B->limbs[0], lo, hi = 0;
+        int sign = A->sign;
+        if (A->sign == b_sign) {
+            if (a >= T81_LIMB_BASE - b) { lo = a - (T81_LIMB_BASE - b); hi = 1; }
+            else lo = a + b;
+        } else if (a >= b) {
+            lo = a - b;
+        } else {
+            lo = b - a;
+            sign = b_sign;
+        }
+        if (t81bigint_reserve(dst, 2)) return 1;
+        dst->limbs[0] = lo;
+        dst->limbs[1] = hi;
+        dst->len = hi ? 2 : 1;
+        dst->sign = (lo || hi) ? sign : 0;
+        return 0;
+    }
+    size_t n = A->len > B->len ? A->len : B->len;
+    if (t81bigint_reserve(dst, n + (A->sign == b_sign))) return 1;
+    dst->len = limbs_add_signed(dst->limbs, A->limbs, A->len, A->sign,
+                                B->limbs, B->len, b_sign, &dst->sign);
+    return 0;
+}
+
+/* In-place variants: dst must be zeroed or hold a live value, and may alias
+   either operand. Its storage is grown only when the result does not fit. */
+TritError tritjs_add_into(T81BigInt* dst, const T81BigInt* A, const T81BigInt* B) {
+    if (!dst || !A || !B) return 2;
+    return add_signed_into(dst, A, B, B->sign);
+}
+
+TritError tritjs_sub_into(T81BigInt* dst, const T81BigInt* A, const T81BigInt* B) {
+    if (!dst || !A || !B) return 2;
+    return add_signed_into(dst, A, B, !B->sign);
+}
+
+/* -1, 0 or 1 as a is below, equal to or above b. */
+int tritjs_compare(const T81BigInt* a, const T81BigInt* b) {
+    if (a->len == 1 && b->len == 1) {
+        T81Limb x = a->limbs[0], y = b->limbs[0];
+        int sx = a->sign && x, sy = b->sign && y;
+        if (sx != sy) return sx ? -1 : 1;
+        int c = (x > y) - (x < y);
+        return sx ? -c : c;
+    }
+    int sx = a->sign && cmp_limbs(a->limbs, a->len, NULL, 0) != 0;
+    int sy = b->sign && cmp_limbs(b->limbs, b->len, NULL, 0) != 0;
+    if (sx != sy) return sx ? -1 : 1;
+    int c = cmp_limbs(a->limbs, a->len, b->limbs, b->len);
+    return sx ? -c : c;
+}
+
+TritError tritjs_add_big(T81BigInt* A, T81BigInt* B, T81BigInt** result) {
+    if (!A || !B) return 2;
+    *result = (T81BigInt*)calloc(1, sizeof(T81BigInt));
+    if (!*result) return 1;
+    TritError e = tritjs_add_into(*result, A, B);
+    if (e) { tritbig_free(*result); *result = NULL; }
+    return e;
+}
+
+TritError tritjs_subtract_big(T81BigInt* A, T81BigInt* B, T81BigInt** result) {
+    if (!A || !B) return 2;
+    *result = (T81BigInt*)calloc(1, sizeof(T81BigInt));
+    if (!*result) return 1;
+    TritError e = tritjs_sub_into(*result, A, B);
+    if (e) { tritbig_free(*result); *result = NULL; }
+    return e;
+}
+
+/* --- Scratch Arena --- */
+/* Per-thread bump allocator for multiplication temporaries. A top-level
+   multiply reserves its whole recursion footprint up front, takes a mark,
+   and releases back to that mark when done; the block then stays with the
+   thread for the next call. Blocks are chained, so a nested user that
+   outgrows the current block gets a fresh one without moving live scratch.
+   Blocks of mmap_bytes or more are mapped like large operands. */
+typedef struct T81ArenaBlock {
+    struct T81ArenaBlock *prev;
+    size_t size;              /* Limbs in data[] */
+    size_t top;               /* Limbs handed out */
+    size_t mapped;            /* Bytes mapped, or 0 if from malloc */
+    T81Limb data[];
+} T81ArenaBlock;
+
+typedef struct {
+    T81ArenaBlock *block;
+    size_t top;
+} T81ArenaMark;
+
+static __thread T81ArenaBlock *t81_arena = NULL;
+
+/* The reciprocal of the last large divisor tritjs_divide_big() saw, so
+   repeated division by one value (modular reduction in a script loop)
+   inverts it only once. */
+static __thread T81Reciprocal t81_div_recip;
+
+static T81ArenaBlock* t81_arena_push(size_t limbs) {
+    size_t bytes = sizeof(T81ArenaBlock) + limbs * sizeof(T81Limb);
+    int kind = t81_map_backend();
+    T81ArenaBlock *b;
+    if (bytes < t81_ctx()->tuning->mmap_bytes) {
+        b = malloc(bytes);
+        if (!b) return NULL;
+        b->mapped = 0;
+    } else {
+        b = t81_map(&bytes, &kind);
+        if (!b) return NULL;
+        b->mapped = bytes;
+        limbs = (bytes - sizeof(T81ArenaBlock)) / sizeof(T81Limb);
+    }
+    b->prev = t81_arena;
+    b->size = limbs;
+    b->top = 0;
+    t81_arena = b;
+    return b;
+}
+
+static void t81_arena_free(T81ArenaBlock *b) {
+    if (b->mapped)
+        t81_unmap(b, b->mapped);
+    else
+        free(b);
+}
+
+/* Makes room for `limbs` more limbs. An idle block that is too small is
+   replaced rather than stacked, so the steady state is one block per thread
+   sized for the largest recent operand. */
+static TritError t81_arena_reserve(size_t limbs) {
+    T81ArenaBlock *b = t81_arena;
+    if (b && b->size - b->top >= limbs) return 0;
+    if (b && b->top == 0) {
+        t81_arena = b->prev;
+        t81_arena_free(b);
+    }
+    return t81_arena_push(limbs) ? 0 : 1;
+}
+
+static T81ArenaMark t81_arena_mark(void) {
+    T81ArenaMark m;
+    m.block = t81_arena;
+    m.top = t81_arena ? t81_arena->top : 0;
+    return m;
+}
+
+static T81Limb* t81_arena_alloc(size_t limbs) {
+    T81ArenaBlock *b = t81_arena;
+    if (!b || b->size - b->top < limbs) {
+        size_t grow = b ? b->size * 2 : 0;
+        b = t81_arena_push(limbs > grow ? limbs : grow);
+        if (!b) return NULL;
+    }
+    T81Limb *p = b->data + b->top;
+    b->top += limbs;
+    return p;
+}
+
+static void t81_arena_release(T81ArenaMark m) {
+    while (t81_arena && t81_arena != m.block) {
+        T81ArenaBlock *b = t81_arena;
+        t81_arena = b->prev;
+        t81_arena_free(b);
+    }
+    if (t81_arena) t81_arena->top = m.top;
+}
+
+/* Frees the calling thread's idle scratch block and cached reciprocal. */
+void tritjs_scratch_release(void) {
+    tritjs_reciprocal_free(&t81_div_recip);
+    while (t81_arena && t81_arena->top == 0) {
+        T81ArenaBlock *b = t81_arena;
+        t81_arena = b->prev;
+        t81_arena_free(b);
+    }
+}
+
+/* --- Parallel Multiplication Pool --- */
+/* Large products fork independent sub-products onto a pool of worker
+   threads. A forked task goes on a shared LIFO stack and idle workers
+   take the newest. A thread waiting in t81_join() takes its own task back
+   if no worker has started it, and otherwise runs other queued tasks until
+   it is done, so a join never idles a core and nested forks cannot
+   deadlock. Each thread's t81_par_budget is how many pieces it may still
+   split its work into: the top-level t81_mul() sets it from the thread
+   count once the shorter operand reaches par_mul limbs, every fork divides
+   it among the children, and below 2 everything runs serially. Workers
+   start on first use, stay for the life of the process and free their
+   scratch after a second without work. */
+#define T81_PAR_SPLIT 4           /* Pieces per thread, for load balance */
+#define T81_PAR_MAX 64            /* Most pieces one parallel loop forks */
+#define T81_POOL_MAX 256
+
+enum { T81_TASK_QUEUED, T81_TASK_RUNNING, T81_TASK_DONE, T81_TASK_FAILED };
+
+typedef struct T81Task {
+    void (*run)(struct T81Task *t);
+    struct T81Task *next;
+    T81Context *ctx;          /* The forking thread's context */
+    size_t budget;            /* t81_par_budget while running */
+    size_t scratch;           /* Arena limbs run() needs */
+    int state;
+} T81Task;
+
+/* A range [lo, hi) of a parallel loop. */
+typedef struct {
+    T81Task task;
+    void (*fn)(void *arg, size_t lo, size_t hi);
+    void *arg;
+    size_t lo, hi;
+} T81RangeTask;
+
+static pthread_mutex_t t81_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t t81_pool_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t t81_pool_done = PTHREAD_COND_INITIALIZER;
+static T81Task *t81_pool_top = NULL;
+static size_t t81_pool_workers = 0;
+static __thread size_t t81_par_budget = 0;
+
+/* Runs t here, in its forker's context. Returns FAILED, without running
+   it, when its scratch cannot be had; the joiner then runs it on its own
+   reservation. */
+static int t81_task_run(T81Task *t) {
+    if (t->scratch && t81_arena_reserve(t->scratch)) return T81_TASK_FAILED;
+    T81Context *ctx = tritjs_context_use(t->ctx);
+    size_t budget = t81_par_budget;
+    t81_par_budget = t->budget;
+    t->run(t);
+    t81_par_budget = budget;
+    tritjs_context_use(ctx);
+    return T81_TASK_DONE;
+}
+
+/* Takes t off the stack (pool lock held), runs it and posts the result. */
+static void t81_pool_run_locked(T81Task *t) {
+    t->state = T81_TASK_RUNNING;
+    pthread_mutex_unlock(&t81_pool_lock);
+    int state = t81_task_run(t);
+    pthread_mutex_lock(&t81_pool_lock);
+    t->state = state;
+    pthread_cond_broadcast(&t81_pool_done);
+}
+
+static void* t81_pool_worker(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&t81_pool_lock);
+    for (;;) {
+        while (!t81_pool_top) {
+            struct timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_sec += 1;
+            if (pthread_cond_timedwait(&t81_pool_work, &t81_pool_lock, &until) == ETIMEDOUT && t81_arena) {
+                pthread_mutex_unlock(&t81_pool_lock);
+                tritjs_scratch_release();
+                pthread_mutex_lock(&t81_pool_lock);
+            }
+        }
+        T81Task *t = t81_pool_top;
+        t81_pool_top = t->next;
+        t81_pool_run_locked(t);
+    }
+    return NULL;
+}
+
+/* Grows the pool to at least n workers. */
+static void t81_pool_start(size_t n) {
+    if (n > T81_POOL_MAX) n = T81_POOL_MAX;
+    if (__atomic_load_n(&t81_pool_workers, __ATOMIC_ACQUIRE) >= n) return;
+    pthread_mutex_lock(&t81_pool_lock);
+    while (t81_pool_workers < n) {
+        pthread_t th;
+        if (pthread_create(&th, NULL, t81_pool_worker, NULL) != 0) break;
+        pthread_detach(th);
+        __atomic_store_n(&t81_pool_workers, t81_pool_workers + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&t81_pool_lock);
+}
+
+static void t81_fork(T81Task *t) {
+    t->ctx = t81_ctx();
+    pthread_mutex_lock(&t81_pool_lock);
+    t->state = T81_TASK_QUEUED;
+    t->next = t81_pool_top;
+    t81_pool_top = t;
+    pthread_cond_signal(&t81_pool_work);
+    pthread_mutex_unlock(&t81_pool_lock);
+}
+
+/* Waits for t, running it here if it is still queued and helping with
+   other queued tasks meanwhile. Returns 1 if t could not get scratch on
+   the thread that took it, and the caller must run it itself. */
+static int t81_join(T81Task *t) {
+    pthread_mutex_lock(&t81_pool_lock);
+    while (t->state == T81_TASK_QUEUED || t->state == T81_TASK_RUNNING) {
+        if (t->state == T81_TASK_QUEUED) {
+            T81Task **p = &t81_pool_top;
+            while (*p != t) p = &(*p)->next;
+            *p = t->next;
+            t81_pool_run_locked(t);
+        } else if (t81_pool_top) {
+            T81Task *other = t81_pool_top;
+            t81_pool_top = other->next;
+            t81_pool_run_locked(other);
+        } else {
+            pthread_cond_wait(&t81_pool_done, &t81_pool_lock);
+        }
+    }
+    pthread_mutex_unlock(&t81_pool_lock);
+    return t->state == T81_TASK_FAILED;
+}
+
+/* Gives a top-level product whose shorter operand has sn limbs its fork
+   budget, starting the pool if needed. Returns the budget to restore. */
+static size_t t81_par_enter(size_t sn) {
+    size_t saved = t81_par_budget;
+    if (!saved && sn >= t81_tuning.par_mul) {
+        size_t threads = t81_thread_count();
+        if (threads > 1) {
+            t81_pool_start(threads - 1);
+            t81_par_budget = T81_PAR_SPLIT * threads;
+        }
+    }
+    return saved;
+}
+
+static void t81_range_task(T81Task *t) {
+    T81RangeTask *r = (T81RangeTask*)t;
+    r->fn(r->arg, r->lo, r->hi);
+}
+
+/* fn(arg, lo, hi) over [0, n) in as many pieces of at least grain as the
+   budget allows. The pieces need no scratch. */
+static void t81_par_for(size_t n, size_t grain, void (*fn)(void *arg, size_t lo, size_t hi), void *arg) {
+    size_t pieces = t81_par_budget < T81_PAR_MAX ? t81_par_budget : T81_PAR_MAX;
+    if (pieces > n / grain) pieces = n / grain;
+    if (pieces < 2) {
+        fn(arg, 0, n);
+        return;
+    }
+    T81RangeTask r[T81_PAR_MAX];
+    for (size_t i = 1; i < pieces; i++) {
+        memset(&r[i].task, 0, sizeof(r[i].task));
+        r[i].task.run = t81_range_task;
+        r[i].task.budget = 1;
+        r[i].fn = fn;
+        r[i].arg = arg;
+        r[i].lo = n * i / pieces;
+        r[i].hi = n * (i + 1) / pieces;
+        t81_fork(&r[i].task);
+    }
+    fn(arg, 0, n / pieces);
+    for (size_t i = 1; i < pieces; i++) t81_join(&r[i].task);
+}
+
+/* --- Multiplication: Karatsuba and Toom-Cook with Cache --- */
+/* Products are cached by a 64-bit hash of both operands' limbs, and a hit
+   is only taken after comparing the stored operands limb for limb. The
+   hash picks one of MUL_CACHE_SHARDS independently locked shards, each a
+   chained table with its own LRU list and an equal share of
+   mul_cache_bytes. Magnitudes are stored, so a*b, b*a and -a*b share an
+   entry. An entry shares the product's buffer with the value it was
+   computed into, and a hit hands out one more share, so neither side
+   copies the product. */
+#define MUL_CACHE_SHARDS 16
+
+typedef struct MulCacheEntry {
+    struct MulCacheEntry *chain;              /* Next in the bucket */
+    struct MulCacheEntry *newer, *older;      /* LRU neighbours */
+    uint64_t hash;
+    size_t alen, blen;
+    T81BigInt prod;                           /* Shares the result's buffer */
+    T81Limb limbs[];                          /* a, then b */
+} MulCacheEntry;
+
+typedef struct MulCacheShard {
+    pthread_mutex_t lock;
+    MulCacheEntry **buckets;
+    size_t nbuckets, entries, bytes;
+    MulCacheEntry *newest, *oldest;
+    unsigned long long hits, misses, evictions;
+} MulCacheShard;
+
+static MulCacheShard mul_cache[MUL_CACHE_SHARDS] = {
+    [0 ... MUL_CACHE_SHARDS - 1] = { .lock = PTHREAD_MUTEX_INITIALIZER }
+};
+
+static void naive_mul(const T81Limb *A, size_t alen,
+                      const T81Limb *B, size_t blen,
+                      T81Limb *out) {
+    memset(out, 0, (alen + blen) * sizeof(T81Limb));
+    for (size_t i = 0; i < alen; i++)
+        out[i + blen] = limbs_addmul_1(out + i, B, blen, A[i]);
+}
+
+/* out[0..2n) = A^2 with each cross product a_i * a_j (i < j) formed once,
+   doubled, and the squares a_i^2 added on the diagonal. */
+static void sqr_basecase(const T81Limb *A, size_t n, T81Limb *out) {
+    out[0] = 0;
+    out[n] = limbs_mul_1(out + 1, A + 1, n - 1, A[0]);
+    for (size_t i = 1; i + 1 < n; i++)
+        out[n + i] = limbs_addmul_1(out + 2 * i + 1, A + i + 1, n - i - 1, A[i]);
+    out[2 * n - 1] = 0;
+    limbs_add_n(out, out, out, 2 * n);
+    T81Limb carry = 0;
+    for (size_t i = 0; i < n; i++) {
+        T81Limb lo, hi = t81_limb_split((T81DLimb)A[i] * A[i], &lo);
+        carry = t81_limb_split((T81DLimb)out[2 * i] + lo + carry, &out[2 * i]);
+        carry = t81_limb_split((T81DLimb)out[2 * i + 1] + hi + carry, &out[2 * i + 1]);
+    }
+}
+
+static void add_shifted(T81Limb *dest, size_t dlen,
+                        const T81Limb *src, size_t slen,
+                        size_t shift) {
+    if (shift >= dlen) return;
+    size_t n = (slen < dlen - shift) ? slen : dlen - shift;
+    T81Limb carry = limbs_add_n(dest + shift, dest + shift, src, n);
+    limbs_add_1(dest + shift + n, dest + shift + n, dlen - shift - n, carry);
+}
+
+static void sub_inplace(T81Limb* out, size_t olen, const T81Limb* src, size_t slen) {
+    T81Limb borrow = limbs_sub_n(out, out, src, slen);
+    limbs_sub_1(out + slen, out + slen, olen - slen, borrow);
+}
+
+/* Multiplication tiers, chosen by operand size in limbs against the
+   runtime cutoffs in t81_tuning. Every tier squares when A == B: the
+   operand is split and evaluated once and each sub-product is itself a
+   square, so the recursion bottoms out in sqr_basecase(). */
+static void t81_mul_n(const T81Limb *A, const T81Limb *B, size_t n, T81Limb *out);
+
+/* Arena limbs each tier takes for itself at one level of an n x n product. */
+static size_t karatsuba_own_scratch(size_t n) { return 4 * (n - n / 2 + 1); }
+static size_t toom3_own_scratch(size_t n) { size_t m = (n + 2) / 3 + 1; return 7 * m + 7 * (2 * m + 2); }
+static size_t toom4_own_scratch(size_t n) { size_t m = (n + 3) / 4 + 1; return 11 * m + 9 * (2 * m + 2); }
+
+/* Scratch for a whole t81_mul_n() call: the tier's own share at every
+   level down the deepest recursion path. */
+static size_t t81_mul_scratch(size_t n) {
+    size_t total = 0;
+    while (n > t81_tuning.karatsuba) {
+        if (n < t81_tuning.toom3) {
+            total += karatsuba_own_scratch(n);
+            n = n - n / 2 + 1;
+        } else if (n < t81_tuning.toom4) {
+            total += toom3_own_scratch(n);
+            n = (n + 2) / 3 + 1;
+        } else {
+            total += toom4_own_scratch(n);
+            n = (n + 3) / 4 + 1;
+        }
+    }
+    return total;
+}
+
+/* One sub-product of a tier's level: out[0..2n) = A * B. */
+typedef struct {
+    T81Task task;
+    const T81Limb *A, *B;
+    size_t n;
+    T81Limb *out;
+} T81MulTask;
+
+static void t81_mul_task(T81Task *t) {
+    T81MulTask *m = (T81MulTask*)t;
+    t81_mul_n(m->A, m->B, m->n, m->out);
+}
+
+/* Forms the k independent sub-products of one level of an n-limb product,
+   forking all but the first when n is past the par_mul cutoff and the
+   budget allows. */
+static void t81_mul_batch(T81MulTask *m, int k, size_t n) {
+    size_t budget = t81_par_budget;
+    if (budget < 2 || n < t81_tuning.par_mul) {
+        for (int i = 0; i < k; i++) t81_mul_n(m[i].A, m[i].B, m[i].n, m[i].out);
+        return;
+    }
+    size_t child = budget / k ? budget / k : 1;
+    for (int i = 1; i < k; i++) {
+        m[i].task.run = t81_mul_task;
+        m[i].task.budget = child;
+        m[i].task.scratch = t81_mul_scratch(m[i].n);
+        t81_fork(&m[i].task);
+    }
+    t81_par_budget = child;
+    t81_mul_n(m[0].A, m[0].B, m[0].n, m[0].out);
+    for (int i = 1; i < k; i++)
+        if (t81_join(&m[i].task)) t81_mul_n(m[i].A, m[i].B, m[i].n, m[i].out);
+    t81_par_budget = budget;
+}
+
+/* out[0..2n) = A * B. The low and high half products land directly in out,
+   so each level only needs scratch for the sums and the middle product.
+   A square needs only the one sum. */
+static void karatsuba(const T81Limb *A, const T81Limb *B, size_t n, T81Limb *out) {
+    if (n <= t81_tuning.karatsuba) { naive_mul(A, n, B, n, out); return; }
+    size_t half = n / 2, r = n - half;
+    const T81Limb *A0 = A, *A1 = A + half;
+    const T81Limb *B0 = B, *B1 = B + half;
+    size_t len2 = 2 * n;
+    T81ArenaMark mark = t81_arena_mark();
+    /* The half sums can carry into one extra limb, so p3 is (r+1) x (r+1). */
+    T81Limb *sumA = t81_arena_alloc(r + 1);
+    T81Limb *sumB = (A == B) ? sumA : t81_arena_alloc(r + 1);
+    T81Limb *p3 = t81_arena_alloc(2 * (r + 1));
+    sumA[r] = limbs_add_1(sumA + half, A1 + half, r - half,
+                          limbs_add_n(sumA, A1, A0, half));
+    if (A != B)
+        sumB[r] = limbs_add_1(sumB + half, B1 + half, r - half,
+                              limbs_add_n(sumB, B1, B0, half));
+    T81MulTask m[3] = {
+        { .A = sumA, .B = sumB, .n = r + 1, .out = p3 },
+        { .A = A0, .B = B0, .n = half, .out = out },
+        { .A = A1, .B = B1, .n = r, .out = out + 2 * half },
+    };
+    t81_mul_batch(m, 3, n);
+    sub_inplace(p3, 2 * (r + 1), out, 2 * half);
+    sub_inplace(p3, 2 * (r + 1), out + 2 * half, 2 * r);
+    add_shifted(out, len2, p3, 2 * (r + 1), half);
+    t81_arena_release(mark);
+}
+
+/* Signed fixed-length values for the Toom evaluations and interpolations:
+   a magnitude of len limbs plus a sign flag. Results may alias inputs. */
+static void tv_add(T81Limb *r, int *rs, const T81Limb *a, int as,
+                   const T81Limb *b, int bs, size_t len) {
+    if (as == bs) {
+        limbs_add_n(r, a, b, len);
+        *rs = as;
+        return;
+    }
+    int c = cmp_limbs(a, len, b, len);
+    if (c >= 0) { limbs_sub_n(r, a, b, len); *rs = c ? as : 0; }
+    else { limbs_sub_n(r, b, a, len); *rs = bs; }
+}
+
+static void tv_sub(T81Limb *r, int *rs, const T81Limb *a, int as,
+                   const T81Limb *b, int bs, size_t len) {
+    tv_add(r, rs, a, as, b, !bs, len);
+}
+
+/* Copies an alen-limb piece into a zero-padded len-limb value. */
+static void tv_load(T81Limb *r, const T81Limb *a, size_t alen, size_t len) {
+    memcpy(r, a, alen * sizeof(T81Limb));
+    memset(r + alen, 0, (len - alen) * sizeof(T81Limb));
+}
+
+/* Widens an m x m product in r to the 2m+2 limbs of a Toom value. */
+static void tv_widen(T81Limb *r, size_t m) {
+    r[2 * m] = r[2 * m + 1] = 0;
+}
+
+/* Evaluates a0 + a1 t + a2 t^2 (pieces of k, k, s limbs) at 1, -1, -2. */
+static void toom3_eval(const T81Limb *A, size_t k, size_t s, size_t m,
+                       T81Limb *e1, T81Limb *em1, int *sm1, T81Limb *em2, int *sm2,
+                       T81Limb *t) {
+    tv_load(e1, A, k, m);
+    tv_load(t, A + 2 * k, s, m);
+    limbs_add_n(e1, e1, t, m);                       /* a0 + a2 */
+    tv_load(t, A + k, k, m);
+    tv_sub(em1, sm1, e1, 0, t, 0, m);                /* A(-1) */
+    limbs_add_n(e1, e1, t, m);                       /* A(1) */
+    tv_load(t, A + 2 * k, s, m);
+    tv_add(em2, sm2, em1, *sm1, t, 0, m);
+    limbs_mul_1(em2, em2, m, 2);
+    tv_load(t, A, k, m);
+    tv_sub(em2, sm2, em2, *sm2, t, 0, m);            /* A(-2) = 2(A(-1) + a2) - a0 */
+}
+
+/* Toom-3: split into thirds of k limbs (top piece s limbs), evaluate at
+   0, 1, -1, -2 and infinity, and interpolate with Bodrato's sequence. */
+static void toom3(const T81Limb *A, const T81Limb *B, size_t n, T81Limb *out) {
+    if (n < 5) { karatsuba(A, B, n, out); return; }
+    size_t k = (n + 2) / 3, s = n - 2 * k;
+    size_t m = k + 1, L = 2 * m + 2;
+    T81ArenaMark mark = t81_arena_mark();
+    T81Limb *a1 = t81_arena_alloc(m), *am1 = t81_arena_alloc(m), *am2 = t81_arena_alloc(m);
+    T81Limb *b1 = a1, *bm1 = am1, *bm2 = am2;
+    T81Limb *t = t81_arena_alloc(m);
+    T81Limb *r1 = t81_arena_alloc(L), *rm1 = t81_arena_alloc(L), *rm2 = t81_arena_alloc(L);
+    T81Limb *c0 = t81_arena_alloc(L), *cinf = t81_arena_alloc(L);
+    int sam1, sam2, sbm1, sbm2, s1 = 0, s2, s3;
+    toom3_eval(A, k, s, m, a1, am1, &sam1, am2, &sam2, t);
+    if (A != B) {
+        b1 = t81_arena_alloc(m); bm1 = t81_arena_alloc(m); bm2 = t81_arena_alloc(m);
+        toom3_eval(B, k, s, m, b1, bm1, &sbm1, bm2, &sbm2, t);
+    } else {
+        sbm1 = sam1; sbm2 = sam2;
+    }
+    /* r(0) and r(inf) go straight to their final places in out. */
+    memset(out + 2 * k, 0, 2 * k * sizeof(T81Limb));
+    T81MulTask mt[5] = {
+        { .A = a1, .B = b1, .n = m, .out = r1 },
+        { .A = am1, .B = bm1, .n = m, .out = rm1 },
+        { .A = am2, .B = bm2, .n = m, .out = rm2 },
+        { .A = A, .B = B, .n = k, .out = out },
+        { .A = A + 2 * k, .B = B + 2 * k, .n = s, .out = out + 4 * k },
+    };
+    t81_mul_batch(mt, 5, n);
+    tv_widen(r1, m);
+    tv_widen(rm1, m);
+    tv_widen(rm2, m);
+    int sr = sam1 ^ sbm1, sr2 = sam2 ^ sbm2;
+    tv_load(c0, out, 2 * k, L);
+    tv_load(cinf, out + 4 * k, 2 * s, L);
+    tv_sub(rm2, &s3, rm2, sr2, r1, 0, L);
+    limbs_divrem_small(rm2, rm2, L, 3);              /* r3 = (r(-2) - r(1)) / 3 */
+    tv_sub(r1, &s1, r1, 0, rm1, sr, L);
+    limbs_divrem_small(r1, r1, L, 2);                /* r1 = (r(1) - r(-1)) / 2 */
+    tv_sub(rm1, &s2, rm1, sr, c0, 0, L);             /* r2 = r(-1) - r(0) */
+    tv_sub(rm2, &s3, rm1, s2, rm2, s3, L);
+    limbs_divrem_small(rm2, rm2, L, 2);
+    tv_add(rm2, &s3, rm2, s3, cinf, 0, L);
+    tv_add(rm2, &s3, rm2, s3, cinf, 0, L);           /* r3 = (r2 - r3) / 2 + 2 r(inf) */
+    tv_add(rm1, &s2, rm1, s2, r1, s1, L);
+    tv_sub(rm1, &s2, rm1, s2, cinf, 0, L);           /* r2 = r2 + r1 - r(inf) */
+    tv_sub(r1, &s1, r1, s1, rm2, s3, L);             /* r1 = r1 - r3 */
+    add_shifted(out, 2 * n, r1, L, k);
+    add_shifted(out, 2 * n, rm1, L, 2 * k);
+    add_shifted(out, 2 * n, rm2, L, 3 * k);
+    t81_arena_release(mark);
+}
+
+/* Evaluates a0 + a1 t + a2 t^2 + a3 t^3 (pieces of k, k, k, s limbs) at
+   1, -1, 2, -2 and, scaled by 8, at 1/2. */
+static void toom4_eval(const T81Limb *A, size_t k, size_t s, size_t m,
+                       T81Limb *e1, T81Limb *em1, int *sm1,
+                       T81Limb *e2, T81Limb *em2, int *sm2, T81Limb *eh,
+                       T81Limb *t, T81Limb *u) {
+    tv_load(e1, A, k, m);
+    tv_load(t, A + 2 * k, k, m);
+    limbs_add_n(e1, e1, t, m);                       /* a0 + a2 */
+    tv_load(u, A + k, k, m);
+    tv_load(t, A + 3 * k, s, m);
+    limbs_add_n(u, u, t, m);                         /* a1 + a3 */
+    tv_sub(em1, sm1, e1, 0, u, 0, m);                /* A(-1) */
+    limbs_add_n(e1, e1, u, m);                       /* A(1) */
+    tv_load(e2, A + 2 * k, k, m);
+    limbs_mul_1(e2, e2, m, 4);
+    tv_load(t, A, k, m);
+    limbs_add_n(e2, e2, t, m);                       /* a0 + 4 a2 */
+    tv_load(u, A + 3 * k, s, m);
+    limbs_mul_1(u, u, m, 4);
+    tv_load(t, A + k, k, m);
+    limbs_add_n(u, u, t, m);
+    limbs_mul_1(u, u, m, 2);                         /* 2 (a1 + 4 a3) */
+    tv_sub(em2, sm2, e2, 0, u, 0, m);                /* A(-2) */
+    limbs_add_n(e2, e2, u, m);                       /* A(2) */
+    tv_load(eh, A, k, m);
+    limbs_mul_1(eh, eh, m, 2);
+    tv_load(t, A + k, k, m);
+    limbs_add_n(eh, eh, t, m);
+    limbs_mul_1(eh, eh, m, 2);
+    tv_load(t, A + 2 * k, k, m);
+    limbs_add_n(eh, eh, t, m);
+    limbs_mul_1(eh, eh, m, 2);
+    tv_load(t, A + 3 * k, s, m);
+    limbs_add_n(eh, eh, t, m);                       /* 8 A(1/2) */
+}
+
+/* Toom-4: split into quarters, evaluate at 0, 1, -1, 2, -2, 1/2 and
+   infinity. Even and odd coefficients are separated from the +/- pairs and
+   solved with exact divisions by 2, 3, 4 and 5 only. */
+static void toom4(const T81Limb *A, const T81Limb *B, size_t n, T81Limb *out) {
+    if (n < 10) { toom3(A, B, n, out); return; }
+    size_t k = (n + 3) / 4, s = n - 3 * k;
+    size_t m = k + 1, L = 2 * m + 2;
+    T81ArenaMark mark = t81_arena_mark();
+    T81Limb *a1 = t81_arena_alloc(m), *am1 = t81_arena_alloc(m), *a2 = t81_arena_alloc(m);
+    T81Limb *am2 = t81_arena_alloc(m), *ah = t81_arena_alloc(m);
+    T81Limb *b1 = a1, *bm1 = am1, *b2 = a2, *bm2 = am2, *bh = ah;
+    T81Limb *t = t81_arena_alloc(m), *u = t81_arena_alloc(m);
+    T81Limb *r1 = t81_arena_alloc(L), *rm1 = t81_arena_alloc(L), *r2 = t81_arena_alloc(L);
+    T81Limb *rm2 = t81_arena_alloc(L), *rh = t81_arena_alloc(L);
+    T81Limb *c0 = t81_arena_alloc(L), *c6 = t81_arena_alloc(L), *w = t81_arena_alloc(L);
+    int sam1, sam2, sbm1, sbm2, se, so, se2, so2, sw, s2, s4, s1, s3, s5, st1, st2, sh;
+    toom4_eval(A, k, s, m, a1, am1, &sam1, a2, am2, &sam2, ah, t, u);
+    if (A != B) {
+        b1 = t81_arena_alloc(m); bm1 = t81_arena_alloc(m); b2 = t81_arena_alloc(m);
+        bm2 = t81_arena_alloc(m); bh = t81_arena_alloc(m);
+        toom4_eval(B, k, s, m, b1, bm1, &sbm1, b2, bm2, &sbm2, bh, t, u);
+    } else {
+        sbm1 = sam1; sbm2 = sam2;
+    }
+    memset(out + 2 * k, 0, 4 * k * sizeof(T81Limb));
+    T81MulTask mt[7] = {
+        { .A = a1, .B = b1, .n = m, .out = r1 },
+        { .A = am1, .B = bm1, .n = m, .out = rm1 },
+        { .A = a2, .B = b2, .n = m, .out = r2 },
+        { .A = am2, .B = bm2, .n = m, .out = rm2 },
+        { .A = ah, .B = bh, .n = m, .out = rh },
+        { .A = A, .B = B, .n = k, .out = out },
+        { .A = A + 3 * k, .B = B + 3 * k, .n = s, .out = out + 6 * k },
+    };
+    t81_mul_batch(mt, 7, n);
+    tv_widen(r1, m);
+    tv_widen(rm1, m);
+    tv_widen(r2, m);
+    tv_widen(rm2, m);
+    tv_widen(rh, m);
+    int srm1 = sam1 ^ sbm1, srm2 = sam2 ^ sbm2;
+    tv_load(c0, out, 2 * k, L);
+    tv_load(c6, out + 6 * k, 2 * s, L);
+    /* Even/odd parts: r1 <- E1 = c0+c2+c4+c6, rm1 <- O1 = c1+c3+c5,
+       r2 <- E2 = c0+4c2+16c4+64c6, rm2 <- O2 = c1+4c3+16c5. */
+    tv_add(w, &sw, r1, 0, rm1, srm1, L);
+    tv_sub(rm1, &so, r1, 0, rm1, srm1, L);
+    limbs_divrem_small(r1, w, L, 2); se = sw;
+    limbs_divrem_small(rm1, rm1, L, 2);
+    tv_add(w, &sw, r2, 0, rm2, srm2, L);
+    tv_sub(rm2, &so2, r2, 0, rm2, srm2, L);
+    limbs_divrem_small(r2, w, L, 2); se2 = sw;
+    limbs_divrem_small(rm2, rm2, L, 4);
+    /* e1 = c2 + c4 (in r1), e2 = c2 + 4c4 (in r2). */
+    tv_sub(r1, &se, r1, se, c0, 0, L);
+    tv_sub(r1, &se, r1, se, c6, 0, L);
+    tv_sub(r2, &se2, r2, se2, c0, 0, L);
+    limbs_mul_1(w, c6, L, 64);
+    tv_sub(r2, &se2, r2, se2, w, 0, L);
+    limbs_divrem_small(r2, r2, L, 4);
+    tv_sub(r2, &s4, r2, se2, r1, se, L);
+    limbs_divrem_small(r2, r2, L, 3);                /* c4 */
+    tv_sub(r1, &s2, r1, se, r2, s4, L);              /* c2 */
+    /* h = (rh - 64c0 - 16c2 - 4c4 - c6) / 2 = 16c1 + 4c3 + c5 (in rh). */
+    sh = 0;
+    limbs_mul_1(w, c0, L, 64);
+    tv_sub(rh, &sh, rh, sh, w, 0, L);
+    limbs_mul_1(w, r1, L, 16);
+    tv_sub(rh, &sh, rh, sh, w, s2, L);
+    limbs_mul_1(w, r2, L, 4);
+    tv_sub(rh, &sh, rh, sh, w, s4, L);
+    tv_sub(rh, &sh, rh, sh, c6, 0, L);
+    limbs_divrem_small(rh, rh, L, 2);
+    /* t1 = (O2 - O1) / 3 = c3 + 5c5 (in rm2), t2 = (16 O1 - h) / 3 = 4c3 + 5c5 (in rh). */
+    tv_sub(rm2, &st1, rm2, so2, rm1, so, L);
+    limbs_divrem_small(rm2, rm2, L, 3);
+    limbs_mul_1(w, rm1, L, 16);
+    tv_sub(rh, &st2, w, so, rh, sh, L);
+    limbs_divrem_small(rh, rh, L, 3);
+    tv_sub(rh, &s3, rh, st2, rm2, st1, L);
+    limbs_divrem_small(rh, rh, L, 3);                /* c3 */
+    tv_sub(rm2, &s5, rm2, st1, rh, s3, L);
+    limbs_divrem_small(rm2, rm2, L, 5);              /* c5 */
+    tv_sub(rm1, &s1, rm1, so, rh, s3, L);
+    tv_sub(rm1, &s1, rm1, s1, rm2, s5, L);           /* c1 */
+    add_shifted(out, 2 * n, rm1, L, k);
+    add_shifted(out, 2 * n, r1, L, 2 * k);
+    add_shifted(out, 2 * n, rh, L, 3 * k);
+    add_shifted(out, 2 * n, r2, L, 4 * k);
+    add_shifted(out, 2 * n, rm2, L, 5 * k);
+    t81_arena_release(mark);
+}
+
+/* out[0..2n) = A * B for two n-limb operands, dispatching on size. */
+static void t81_mul_n(const T81Limb *A, const T81Limb *B, size_t n, T81Limb *out) {
+    if (n <= t81_tuning.karatsuba) {
+        if (A == B) sqr_basecase(A, n, out);
+        else naive_mul(A, n, B, n, out);
+    } else if (n < t81_tuning.toom3) karatsuba(A, B, n, out);
+    else if (n < t81_tuning.toom4) toom3(A, B, n, out);
+    else toom4(A, B, n, out);
+}
+
+/* Exact transform multiplication for huge operands. The limb convolution
+   is computed modulo three primes c*2^k + 1 and rebuilt by CRT: every
+   coefficient is below n * (3^40)^2 < n * 2^127, well inside the ~2^184
+   product of the primes. Residues use Montgomery arithmetic with R = 2^64
+   (all primes are below 2^62, so lazy sums never overflow). The forward
+   transform is decimation-in-frequency and leaves bit-reversed order,
+   which the decimation-in-time inverse consumes directly, so both run in
+   place with no permutation pass. */
+
+typedef struct {
+    uint64_t p;
+    uint64_t g;               /* Primitive root mod p */
+} T81NttPrime;
+
+static const T81NttPrime t81_ntt_primes[3] = {
+    { 4179340454199820289ULL, 3 },   /* 29 * 2^57 + 1 */
+    { 2485986994308513793ULL, 5 },   /* 69 * 2^55 + 1 */
+    { 2936346957045563393ULL, 3 },   /* 163 * 2^54 + 1 */
+};
+
+/* t * 2^-64 mod p for t < 2^64 * p; pinv = -p^-1 mod 2^64. */
+static inline uint64_t ntt_redc(T81DLimb t, uint64_t p, uint64_t pinv) {
+    uint64_t m = (uint64_t)t * pinv;
+    uint64_t u = (uint64_t)((t + (T81DLimb)m * p) >> 64);
+    return u >= p ? u - p : u;
+}
+
+/* Plain modular helpers, used only for per-call setup constants. */
+static uint64_t ntt_mulmod(uint64_t a, uint64_t b, uint64_t p) {
+    return (uint64_t)((T81DLimb)a * b % p);
+}
+
+static uint64_t ntt_powmod(uint64_t b, uint64_t e, uint64_t p) {
+    uint64_t r = 1;
+    for (; e; e >>= 1, b = ntt_mulmod(b, b, p))
+        if (e & 1) r = ntt_mulmod(r, b, p);
+    return r;
+}
+
+static uint64_t ntt_neg_inv(uint64_t p) {
+    uint64_t inv = p;                /* Correct to 3 bits for odd p */
+    for (int i = 0; i < 5; i++) inv *= 2 - p * inv;
+    return (uint64_t)0 - inv;
+}
+
+/* Montgomery form of v: v * 2^64 mod p. */
+static uint64_t ntt_to_mont(uint64_t v, uint64_t p) {
+    return (uint64_t)(((T81DLimb)(v % p) << 64) % p);
+}
+
+/* tw[len + j] = w_len^j in Montgomery form, w_len a primitive (2*len)-th
+   root, for every power-of-two len < N. */
+static void ntt_twiddles(uint64_t *tw, size_t N, uint64_t w, uint64_t p, uint64_t pinv) {
+    size_t half = N >> 1;
+    uint64_t wm = ntt_to_mont(w, p), x = ntt_to_mont(1, p);
+    for (size_t j = 0; j < half; j++) {
+        tw[half + j] = x;
+        x = ntt_redc((T81DLimb)x * wm, p, pinv);
+    }
+    for (size_t len = half >> 1; len >= 1; len >>= 1)
+        for (size_t j = 0; j < len; j++)
+            tw[len + j] = tw[2 * len + 2 * j];
+}
+
+static void ntt_forward(uint64_t *a, size_t N, const uint64_t *tw, uint64_t p, uint64_t pinv) {
+    for (size_t len = N >> 1; len >= 1; len >>= 1)
+        for (size_t s = 0; s < N; s += 2 * len)
+            for (size_t j = 0; j < len; j++) {
+                uint64_t u = a[s + j], v = a[s + j + len];
+                uint64_t x = u + v;
+                a[s + j] = x >= p ? x - p : x;
+                a[s + j + len] = ntt_redc((T81DLimb)(u + p - v) * tw[len + j], p, pinv);
+            }
+}
+
+static void ntt_inverse(uint64_t *a, size_t N, const uint64_t *tw, uint64_t p, uint64_t pinv) {
+    for (size_t len = 1; len < N; len <<= 1)
+        for (size_t s = 0; s < N; s += 2 * len)
+            for (size_t j = 0; j < len; j++) {
+                uint64_t u = a[s + j];
+                uint64_t v = ntt_redc((T81DLimb)a[s + j + len] * tw[len + j], p, pinv);
+                uint64_t x = u + v;
+                a[s + j] = x >= p ? x - p : x;
+                a[s + j + len] = u >= v ? u - v : u + p - v;
+            }
+}
+
+static size_t ntt_size(size_t coeffs) {
+    size_t N = 2;
+    while (N < coeffs) N <<= 1;
+    return N;
+}
+
+/* Arena limbs t81_ntt_mul() needs for an out_len-limb product. */
+static size_t t81_ntt_scratch(size_t out_len) {
+    return 6 * ntt_size(out_len - 1);
+}
+
+/* Parallel pieces of a transform product. Above T81_NTT_GRAIN points a
+   transform splits into 2^d blocks: the stages whose butterflies cross
+   blocks run as parallel loops over butterflies, and the rest as
+   independent block transforms, which use the same twiddle table. Residue
+   loads, the pointwise product and the Garner pass split by index. */
+#define T81_NTT_GRAIN 4096
+
+typedef struct {
+    uint64_t *a;
+    const uint64_t *b;        /* Pointwise: the other transform */
+    const T81Limb *src;       /* Load: limbs to reduce */
+    const uint64_t *tw;
+    size_t len;               /* Stage half-width, or source limbs */
+    size_t block;             /* Points per block transform */
+    uint64_t p, pinv, scale;
+} T81NttRange;
+
+static void ntt_load_range(void *arg, size_t lo, size_t hi) {
+    T81NttRange *r = (T81NttRange*)arg;
+    for (size_t j = lo; j < hi; j++) r->a[j] = j < r->len ? r->src[j] % r->p : 0;
+}
+
+/* redc(redc(a*b) * N^-1 R^2) leaves the plain product scaled by 1/N. */
+static void ntt_point_range(void *arg, size_t lo, size_t hi) {
+    T81NttRange *r = (T81NttRange*)arg;
+    for (size_t j = lo; j < hi; j++)
+        r->a[j] = ntt_redc((T81DLimb)ntt_redc((T81DLimb)r->a[j] * r->b[j], r->p, r->pinv) * r->scale,
+                           r->p, r->pinv);
+}
+
+/* Butterflies [lo, hi) of one stage; butterfly i = q*len + j pairs
+   a[2q*len + j] with a[2q*len + j + len]. */
+static void ntt_fwd_stage_range(void *arg, size_t lo, size_t hi) {
+    T81NttRange *r = (T81NttRange*)arg;
+    uint64_t *a = r->a, p = r->p;
+    size_t len = r->len;
+    for (size_t i = lo; i < hi; i++) {
+        size_t j = i & (len - 1), at = 2 * (i - j) + j;
+        uint64_t u = a[at], v = a[at + len];
+        uint64_t x = u + v;
+        a[at] = x >= p ? x - p : x;
+        a[at + len] = ntt_redc((T81DLimb)(u + p - v) * r->tw[len + j], p, r->pinv);
+    }
+}
+
+static void ntt_inv_stage_range(void *arg, size_t lo, size_t hi) {
+    T81NttRange *r = (T81NttRange*)arg;
+    uint64_t *a = r->a, p = r->p;
+    size_t len = r->len;
+    for (size_t i = lo; i < hi; i++) {
+        size_t j = i & (len - 1), at = 2 * (i - j) + j;
+        uint64_t u = a[at];
+        uint64_t v = ntt_redc((T81DLimb)a[at + len] * r->tw[len + j], p, r->pinv);
+        uint64_t x = u + v;
+        a[at] = x >= p ? x - p : x;
+        a[at + len] = u >= v ? u - v : u + p - v;
+    }
+}
+
+static void ntt_fwd_block_range(void *arg, size_t lo, size_t hi) {
+    T81NttRange *r = (T81NttRange*)arg;
+    for (size_t k = lo; k < hi; k++) ntt_forward(r->a + k * r->block, r->block, r->tw, r->p, r->pinv);
+}
+
+static void ntt_inv_block_range(void *arg, size_t lo, size_t hi) {
+    T81NttRange *r = (T81NttRange*)arg;
+    for (size_t k = lo; k < hi; k++) ntt_inverse(r->a + k * r->block, r->block, r->tw, r->p, r->pinv);
+}
+
+/* Points per block for an N-point transform under the current budget;
+   N itself means serial. */
+static size_t ntt_par_block(size_t N) {
+    size_t block = N;
+    for (size_t pieces = t81_par_budget; pieces > 1 && block / 2 >= T81_NTT_GRAIN; pieces >>= 1)
+        block >>= 1;
+    return block;
+}
+
+static void ntt_forward_par(uint64_t *a, size_t N, const uint64_t *tw, uint64_t p, uint64_t pinv) {
+    T81NttRange r = { .a = a, .tw = tw, .p = p, .pinv = pinv, .block = ntt_par_block(N) };
+    if (r.block == N) {
+        ntt_forward(a, N, tw, p, pinv);
+        return;
+    }
+    for (r.len = N >> 1; r.len >= r.block; r.len >>= 1)
+        t81_par_for(N / 2, T81_NTT_GRAIN / 2, ntt_fwd_stage_range, &r);
+    t81_par_for(N / r.block, 1, ntt_fwd_block_range, &r);
+}
+
+static void ntt_inverse_par(uint64_t *a, size_t N, const uint64_t *tw, uint64_t p, uint64_t pinv) {
+    T81NttRange r = { .a = a, .tw = tw, .p = p, .pinv = pinv, .block = ntt_par_block(N) };
+    if (r.block == N) {
+        ntt_inverse(a, N, tw, p, pinv);
+        return;
+    }
+    t81_par_for(N / r.block, 1, ntt_inv_block_range, &r);
+    for (r.len = r.block; r.len < N; r.len <<= 1)
+        t81_par_for(N / 2, T81_NTT_GRAIN / 2, ntt_inv_stage_range, &r);
+}
+
+/* One prime's share of a transform product: the residues of A (and B)
+   are transformed, multiplied pointwise and transformed back into res.
+   fb, tw and itw are N-word scratch; a forked pass leaves them NULL and
+   takes them from its own thread's arena. */
+typedef struct {
+    T81Task task;
+    const T81Limb *A, *B;
+    size_t alen, blen, N;
+    int square, prime;
+    uint64_t *res, *fb, *tw, *itw;
+} T81NttTask;
+
+static void ntt_prime_pass(T81NttTask *t) {
+    size_t N = t->N;
+    uint64_t p = t81_ntt_primes[t->prime].p, pinv = ntt_neg_inv(p);
+    uint64_t w = ntt_powmod(t81_ntt_primes[t->prime].g, (p - 1) / N, p);
+    ntt_twiddles(t->tw, N, w, p, pinv);
+    ntt_twiddles(t->itw, N, ntt_powmod(w, p - 2, p), p, pinv);
+    T81NttRange r = { .a = t->res, .src = t->A, .len = t->alen, .p = p, .pinv = pinv };
+    t81_par_for(N, T81_NTT_GRAIN, ntt_load_range, &r);
+    ntt_forward_par(t->res, N, t->tw, p, pinv);
+    if (!t->square) {
+        r.a = t->fb; r.src = t->B; r.len = t->blen;
+        t81_par_for(N, T81_NTT_GRAIN, ntt_load_range, &r);
+        ntt_forward_par(t->fb, N, t->tw, p, pinv);
+    }
+    r.a = t->res;
+    r.b = t->square ? t->res : t->fb;
+    r.scale = ntt_mulmod(ntt_powmod(N % p, p - 2, p),
+                         ntt_mulmod(ntt_to_mont(1, p), ntt_to_mont(1, p), p), p);
+    t81_par_for(N, T81_NTT_GRAIN, ntt_point_range, &r);
+    ntt_inverse_par(t->res, N, t->itw, p, pinv);
+}
+
+static void ntt_prime_task(T81Task *task) {
+    T81NttTask *t = (T81NttTask*)task;
+    T81ArenaMark mark = t81_arena_mark();
+    t->fb = t81_arena_alloc(t->N);
+    t->tw = t81_arena_alloc(t->N);
+    t->itw = t81_arena_alloc(t->N);
+    ntt_prime_pass(t);
+    t81_arena_release(mark);
+}
+
+/* Garner: v = x1 + x2 p1 + x3 p1 p2 per coefficient, then carry-propagate
+   in base 3^40. Pieces propagate their own carries from zero and the
+   carries between pieces are added afterwards. */
+typedef struct {
+    uint64_t *res[3];
+    T81Limb *out;
+    size_t coeffs, pieces;
+    T81DLimb carry[T81_PAR_MAX];
+    uint64_t pinv2, pinv3, inv12, inv123, p1_3, p12lo, p12hi;
+} T81Garner;
+
+static void ntt_garner_range(void *arg, size_t lo, size_t hi) {
+    T81Garner *g = (T81Garner*)arg;
+    uint64_t p1 = t81_ntt_primes[0].p, p2 = t81_ntt_primes[1].p, p3 = t81_ntt_primes[2].p;
+    for (size_t piece = lo; piece < hi; piece++) {
+        T81DLimb carry = 0;
+        size_t end = g->coeffs * (piece + 1) / g->pieces;
+        for (size_t j = g->coeffs * piece / g->pieces; j < end; j++) {
+            uint64_t x1 = g->res[0][j], r2 = g->res[1][j], r3 = g->res[2][j];
+            uint64_t t = x1 % p2;
+            uint64_t x2 = ntt_redc((T81DLimb)(r2 >= t ? r2 - t : r2 + p2 - t) * g->inv12, p2, g->pinv2);
+            t = x1 % p3 + ntt_redc((T81DLimb)x2 * g->p1_3, p3, g->pinv3);
+            if (t >= p3) t -= p3;
+            uint64_t x3 = ntt_redc((T81DLimb)(r3 >= t ? r3 - t : r3 + p3 - t) * g->inv123, p3, g->pinv3);
+            T81DLimb low = (T81DLimb)x2 * p1 + x1;
+            T81DLimb s = (T81DLimb)x3 * g->p12lo + (uint64_t)low;
+            uint64_t w0 = (uint64_t)s;
+            s = (T81DLimb)x3 * g->p12hi + (uint64_t)(low >> 64) + (uint64_t)(s >> 64);
+            uint64_t w1 = (uint64_t)s, w2 = (uint64_t)(s >> 64);
+            s = (T81DLimb)w0 + (uint64_t)carry;
+            w0 = (uint64_t)s;
+            s = (T81DLimb)w1 + (uint64_t)(carry >> 64) + (uint64_t)(s >> 64);
+            w1 = (uint64_t)s;
+            w2 += (uint64_t)(s >> 64);
+            T81Limb r;
+            T81Limb q1 = t81_limb_divmod(w2, w1, &r);
+            T81Limb q0 = t81_limb_divmod(r, w0, &g->out[j]);
+            carry = ((T81DLimb)q1 << 64) | q0;
+        }
+        g->carry[piece] = carry;
+    }
+}
+
+/* out[0..alen+blen) = A * B. A == B (same length) skips the second
+   forward transform. With a fork budget the three primes run as parallel
+   tasks, each splitting its transforms further. */
+static void t81_ntt_mul(const T81Limb *A, size_t alen, const T81Limb *B, size_t blen, T81Limb *out) {
+    size_t coeffs = alen + blen - 1, N = ntt_size(coeffs);
+    T81ArenaMark mark = t81_arena_mark();
+    T81NttTask t[3];
+    memset(t, 0, sizeof(t));
+    for (int i = 0; i < 3; i++) {
+        t[i].A = A; t[i].B = B; t[i].alen = alen; t[i].blen = blen; t[i].N = N;
+        t[i].square = (A == B && alen == blen);
+        t[i].prime = i;
+        t[i].res = t81_arena_alloc(N);
+    }
+    uint64_t *fb = t81_arena_alloc(N), *tw = t81_arena_alloc(N), *itw = t81_arena_alloc(N);
+    size_t budget = t81_par_budget, child = budget / 3 ? budget / 3 : 1;
+    if (budget >= 2) {
+        for (int i = 1; i < 3; i++) {
+            t[i].task.run = ntt_prime_task;
+            t[i].task.budget = child;
+            t[i].task.scratch = 3 * N;
+            t81_fork(&t[i].task);
+        }
+        t81_par_budget = child;
+    }
+    for (int i = 0; i < 3; i++) {
+        if (budget >= 2 && i > 0 && !t81_join(&t[i].task)) continue;
+        t[i].fb = fb; t[i].tw = tw; t[i].itw = itw;
+        ntt_prime_pass(&t[i]);
+    }
+    t81_par_budget = budget;
+    uint64_t p1 = t81_ntt_primes[0].p, p2 = t81_ntt_primes[1].p, p3 = t81_ntt_primes[2].p;
+    T81Garner g;
+    for (int i = 0; i < 3; i++) g.res[i] = t[i].res;
+    g.out = out;
+    g.coeffs = coeffs;
+    g.pieces = budget < T81_PAR_MAX ? budget : T81_PAR_MAX;
+    if (g.pieces > coeffs / T81_NTT_GRAIN) g.pieces = coeffs / T81_NTT_GRAIN;
+    if (g.pieces < 1) g.pieces = 1;
+    g.pinv2 = ntt_neg_inv(p2);
+    g.pinv3 = ntt_neg_inv(p3);
+    g.inv12 = ntt_to_mont(ntt_powmod(p1 % p2, p2 - 2, p2), p2);
+    g.inv123 = ntt_to_mont(ntt_powmod(ntt_mulmod(p1 % p3, p2 % p3, p3), p3 - 2, p3), p3);
+    g.p1_3 = ntt_to_mont(p1, p3);
+    T81DLimb p12 = (T81DLimb)p1 * p2;
+    g.p12lo = (uint64_t)p12;
+    g.p12hi = (uint64_t)(p12 >> 64);
+    t81_par_for(g.pieces, 1, ntt_garner_range, &g);
+    /* Each carry is below 2^86, so it is two limbs added at the start of
+       the next piece; a carry out of that piece joins the piece's own. */
+    T81DLimb carry = g.carry[0];
+    for (size_t piece = 1; piece < g.pieces; piece++) {
+        size_t lo = coeffs * piece / g.pieces, hi = coeffs * (piece + 1) / g.pieces;
+        T81Limb c0, c1 = t81_limb_divmod((T81Limb)(carry >> 64), (T81Limb)carry, &c0);
+        T81Limb up = limbs_add_1(out + lo, out + lo, hi - lo, c0);
+        up += limbs_add_1(out + lo + 1, out + lo + 1, hi - lo - 1, c1);
+        carry = g.carry[piece] + up;
+    }
+    out[coeffs] = (T81Limb)carry;
+    t81_arena_release(mark);
+}
+
+/* Returns x's limbs zero-padded to n, borrowing arena scratch only when
+   x is shorter than n. */
+static const T81Limb* padded_operand(const T81Limb *x, size_t len, size_t n) {
+    if (len >= n) return x;
+    T81Limb *p = t81_arena_alloc(n);
+    memcpy(p, x, len * sizeof(T81Limb));
+    memset(p + len, 0, (n - len) * sizeof(T81Limb));
+    return p;
+}
+
+/* Arena limbs t81_mul() needs for a bn x sn product. */
+static size_t t81_mul_any_scratch(size_t bn, size_t sn) {
+    if (sn >= t81_tuning.ntt) return t81_ntt_scratch(bn + sn);
+    if (sn <= t81_tuning.karatsuba) return 0;
+    if (bn >= 2 * sn) return 3 * sn + t81_mul_scratch(sn);
+    return (sn < bn ? 3 * bn : 0) + t81_mul_scratch(bn);
+}
+
+/* out[0..bn+sn) = big * small for bn >= sn >= 1. out must not overlap the
+   operands. Once the shorter operand reaches the NTT cutoff the whole
+   product is one transform. Below it, the same limbs passed twice are
+   squared, operands of similar length are padded to a balanced n x n
+   product, and a much longer operand is cut into blocks the size of the
+   shorter one. */
+static void t81_mul(T81Limb *out, const T81Limb *big, size_t bn, const T81Limb *small, size_t sn) {
+    size_t budget = t81_par_enter(sn);
+    T81ArenaMark mark = t81_arena_mark();
+    if (sn >= t81_tuning.ntt) {
+        t81_ntt_mul(big, bn, small, sn, out);
+    } else if (big == small && sn == bn) {
+        t81_mul_n(big, big, bn, out);
+    } else if (sn <= t81_tuning.karatsuba) {
+        naive_mul(small, sn, big, bn, out);
+    } else if (bn >= 2 * sn) {
+        T81Limb *block = t81_arena_alloc(2 * sn);
+        memset(out, 0, (bn + sn) * sizeof(T81Limb));
+        for (size_t off = 0; off < bn; off += sn) {
+            size_t c = (bn - off < sn) ? bn - off : sn;
+            T81ArenaMark inner = t81_arena_mark();
+            const T81Limb *piece = padded_operand(big + off, c, sn);
+            t81_mul_n(piece, small, sn, block);
+            add_shifted(out, bn + sn, block, 2 * sn, off);
+            t81_arena_release(inner);
+        }
+    } else if (sn == bn) {
+        t81_mul_n(big, small, bn, out);
+    } else {
+        const T81Limb *S = padded_operand(small, sn, bn);
+        T81Limb *full = t81_arena_alloc(2 * bn);
+        t81_mul_n(big, S, bn, full);
+        memcpy(out, full, (bn + sn) * sizeof(T81Limb));
+    }
+    t81_arena_release(mark);
+    t81_par_budget = budget;
+}
+
+/* out must be zeroed or hold a live value. When it does not alias an
+   operand, the product is written straight into its (reused) buffer. All
+   temporaries come from one arena reservation sized from the operands. */
+static TritError t81bigint_fast_multiply(const T81BigInt *a, const T81BigInt *b, T81BigInt *out) {
+    if (a->len == 1 && b->len == 1) {
+        /* One limb each: one 128-bit product, kept in out's inline limbs. */
+        T81Limb lo, hi = t81_limb_split((T81DLimb)a->limbs[0] * b->limbs[0], &lo);
+        int sign = (lo || hi) && a->sign != b->sign;
+        if (t81bigint_reserve(out, 2)) return 1;
+        out->limbs[0] = lo;
+        out->limbs[1] = hi;
+        out->len = hi ? 2 : 1;
+        out->sign = sign;
+        return 0;
+    }
+    t81_tuning_init();
+    if ((a->len == 1 && a->limbs[0] == 0) || (b->len == 1 && b->limbs[0] == 0)) {
+        if (allocate_digits(out, 1)) return 1;
+        out->limbs[0] = 0; out->sign = 0;
+        return 0;
+    }
+    const T81BigInt *big = (a->len >= b->len) ? a : b;
+    const T81BigInt *small = (big == a) ? b : a;
+    size_t bn = big->len, sn = small->len;
+    int sign = (a->sign != b->sign) ? 1 : 0;
+    size_t out_len = bn + sn;
+    int aliased = (out == a || out == b);
+    if (!aliased && t81bigint_reserve(out, out_len)) return 1;
+    if (t81_arena_reserve((aliased ? out_len : 0) + t81_mul_any_scratch(bn, sn))) return 1;
+    T81ArenaMark mark = t81_arena_mark();
+    T81Limb *prod = aliased ? t81_arena_alloc(out_len) : out->limbs;
+    t81_mul(prod, big->limbs, bn, small->limbs, sn);
+    while (out_len > 1 && prod[out_len - 1] == 0) out_len--;
+    TritError e = 0;
+    if (aliased) {
+        e = t81bigint_reserve(out, out_len);
+        if (!e) memcpy(out->limbs, prod, out_len * sizeof(T81Limb));
+    }
+    t81_arena_release(mark);
+    if (e) return e;
+    out->len = out_len;
+    out->sign = sign;
+    return 0;
+}
+
+static uint64_t limbs_hash(const T81Limb *x, size_t n) {
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ n;
+    for (size_t i = 0; i < n; i++) {
+        h = (h ^ x[i]) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+    return h;
+}
+
+static size_t mul_cache_entry_bytes(const MulCacheEntry *c) {
+    return sizeof(*c) + (c->alen + c->blen + c->prod.capacity) * sizeof(T81Limb);
+}
+
+/* Whether c holds the product of the a and b magnitudes, in either order. */
+static int mul_cache_matches(const MulCacheEntry *c, uint64_t h, const T81Limb *a, size_t an,
+                             const T81Limb *b, size_t bn) {
+    if (c->hash != h) return 0;
+    const T81Limb *ca = c->limbs, *cb = c->limbs + c->alen;
+    if (c->alen == an && c->blen == bn &&
+        !memcmp(ca, a, an * sizeof(T81Limb)) && !memcmp(cb, b, bn * sizeof(T81Limb)))
+        return 1;
+    return c->alen == bn && c->blen == an &&
+           !memcmp(ca, b, bn * sizeof(T81Limb)) && !memcmp(cb, a, an * sizeof(T81Limb));
+}
+
+static void mul_cache_unlink(MulCacheShard *sh, MulCacheEntry *c) {
+    if (c->newer) c->newer->older = c->older; else sh->newest = c->older;
+    if (c->older) c->older->newer = c->newer; else sh->oldest = c->newer;
+}
+
+static void mul_cache_push(MulCacheShard *sh, MulCacheEntry *c) {
+    c->newer = NULL;
+    c->older = sh->newest;
+    if (sh->newest) sh->newest->newer = c; else sh->oldest = c;
+    sh->newest = c;
+}
+
+static void mul_cache_remove(MulCacheShard *sh, MulCacheEntry *c) {
+    MulCacheEntry **p = &sh->buckets[(c->hash / MUL_CACHE_SHARDS) & (sh->nbuckets - 1)];
+    while (*p != c) p = &(*p)->chain;
+    *p = c->chain;
+    mul_cache_unlink(sh, c);
+    sh->entries--;
+    sh->bytes -= mul_cache_entry_bytes(c);
+    t81bigint_free(&c->prod);
+    free(c);
+}
+
+/* Doubles the bucket array once the shard holds more entries than buckets;
+   a failed resize just leaves the chains longer. */
+static void mul_cache_grow(MulCacheShard *sh) {
+    size_t nb = sh->nbuckets ? 2 * sh->nbuckets : 16;
+    MulCacheEntry **nbk = (MulCacheEntry**)calloc(nb, sizeof(*nbk));
+    if (!nbk) return;
+    for (size_t i = 0; i < sh->nbuckets; i++) {
+        for (MulCacheEntry *c = sh->buckets[i], *next; c; c = next) {
+            next = c->chain;
+            MulCacheEntry **slot = &nbk[(c->hash / MUL_CACHE_SHARDS) & (nb - 1)];
+            c->chain = *slot;
+            *slot = c;
+        }
+    }
+    free(sh->buckets);
+    sh->buckets = nbk;
+    sh->nbuckets = nb;
+}
+
+/* Gives dst a cached product, sharing the entry's buffer. Returns 0 on a
+   hit, 2 on a miss. */
+static int mul_cache_lookup(uint64_t h, const T81Limb *a, size_t an, const T81Limb *b, size_t bn,
+                            T81BigInt *dst) {
+    MulCacheShard *sh = &t81_ctx()->cache[h % MUL_CACHE_SHARDS];
+    int r = 2;
+    pthread_mutex_lock(&sh->lock);
+    MulCacheEntry *c = sh->nbuckets ? sh->buckets[(h / MUL_CACHE_SHARDS) & (sh->nbuckets - 1)] : NULL;
+    while (c && !mul_cache_matches(c, h, a, an, b, bn)) c = c->chain;
+    if (c && t81bigint_share(dst, &c->prod) == 0) {
+        mul_cache_unlink(sh, c);
+        mul_cache_push(sh, c);
+        sh->hits++;
+        r = 0;
+    } else {
+        sh->misses++;
+    }
+    pthread_mutex_unlock(&sh->lock);
+    return r;
+}
+
+/* Adds c, whose operands are already filled in, with the product in val,
+   whose buffer the entry then shares. Takes ownership of c. Older entries
+   are evicted to keep the shard within its share of the budget, counting
+   the whole shared buffer; an entry larger than the whole share is not
+   kept. */
+static void mul_cache_store(MulCacheEntry *c, T81BigInt *val) {
+    T81Context *ctx = t81_ctx();
+    MulCacheShard *sh = &ctx->cache[c->hash % MUL_CACHE_SHARDS];
+    size_t budget = ctx->tuning->mul_cache_bytes / MUL_CACHE_SHARDS;
+    memset(&c->prod, 0, sizeof(c->prod));
+    if (t81bigint_is_inline(val) || t81bigint_share(&c->prod, val)) {
+        free(c);
+        return;
+    }
+    size_t bytes = mul_cache_entry_bytes(c);
+    pthread_mutex_lock(&sh->lock);
+    MulCacheEntry *dup = sh->nbuckets ? sh->buckets[(c->hash / MUL_CACHE_SHARDS) & (sh->nbuckets - 1)] : NULL;
+    while (dup && !mul_cache_matches(dup, c->hash, c->limbs, c->alen, c->limbs + c->alen, c->blen))
+        dup = dup->chain;
+    if (dup || bytes > budget) {
+        pthread_mutex_unlock(&sh->lock);
+        t81bigint_free(&c->prod);
+        free(c);
+        return;
+    }
+    while (sh->bytes + bytes > budget) {
+        mul_cache_remove(sh, sh->oldest);
+        sh->evictions++;
+    }
+    if (sh->entries >= sh->nbuckets) mul_cache_grow(sh);
+    if (!sh->nbuckets) {
+        pthread_mutex_unlock(&sh->lock);
+        t81bigint_free(&c->prod);
+        free(c);
+        return;
+    }
+    MulCacheEntry **slot = &sh->buckets[(c->hash / MUL_CACHE_SHARDS) & (sh->nbuckets - 1)];
+    c->chain = *slot;
+    *slot = c;
+    mul_cache_push(sh, c);
+    sh->entries++;
+    sh->bytes += bytes;
+    pthread_mutex_unlock(&sh->lock);
+}
+
+/* Products the schoolbook kernel handles are cheaper to redo than to
+   hash, copy and store, so only larger ones go through the cache. The
+   operands are copied into the new entry before multiplying because out
+   may alias either of them. */
+static TritError multiply_with_cache(const T81BigInt *a, const T81BigInt *b, T81BigInt *out) {
+    t81_tuning_init();
+    size_t an = a->len, bn = b->len;
+    while (an > 1 && a->limbs[an - 1] == 0) an--;
+    while (bn > 1 && b->limbs[bn - 1] == 0) bn--;
+    if ((an < bn ? an : bn) <= t81_tuning.karatsuba || !t81_ctx()->tuning->mul_cache_bytes)
+        return t81bigint_fast_multiply(a, b, out);
+    uint64_t ha = limbs_hash(a->limbs, an), hb = limbs_hash(b->limbs, bn);
+    uint64_t h = (ha < hb) ? ha * 31 + hb : hb * 31 + ha;
+    int sign = (a->sign != b->sign) ? 1 : 0;
+    if (mul_cache_lookup(h, a->limbs, an, b->limbs, bn, out) == 0) {
+        out->sign = sign;
+        return 0;
+    }
+    MulCacheEntry *c = (MulCacheEntry*)malloc(sizeof(MulCacheEntry) + (an + bn) * sizeof(T81Limb));
+    if (c) {
+        c->hash = h;
+        c->alen = an;
+        c->blen = bn;
+        memcpy(c->limbs, a->limbs, an * sizeof(T81Limb));
+        memcpy(c->limbs + an, b->limbs, bn * sizeof(T81Limb));
+    }
+    TritError e = t81bigint_fast_multiply(a, b, out);
+    if (e || !c) free(c);
+    else mul_cache_store(c, out);
+    return e;
+}
+
+static void mul_cache_sum(MulCacheShard *cache, T81CacheStats *out) {
+    memset(out, 0, sizeof(*out));
+    for (int i = 0; i < MUL_CACHE_SHARDS; i++) {
+        MulCacheShard *sh = &cache[i];
+        pthread_mutex_lock(&sh->lock);
+        out->hits += sh->hits;
+        out->misses += sh->misses;
+        out->evictions += sh->evictions;
+        out->entries += sh->entries;
+        out->bytes += sh->bytes;
+        pthread_mutex_unlock(&sh->lock);
+    }
+}
+
+static void mul_cache_drop(MulCacheShard *cache) {
+    for (int i = 0; i < MUL_CACHE_SHARDS; i++) {
+        MulCacheShard *sh = &cache[i];
+        pthread_mutex_lock(&sh->lock);
+        while (sh->oldest) mul_cache_remove(sh, sh->oldest);
+        free(sh->buckets);
+        sh->buckets = NULL;
+        sh->nbuckets = 0;
+        sh->hits = sh->misses = sh->evictions = 0;
+        pthread_mutex_unlock(&sh->lock);
+    }
+}
+
+/* Counters of the current context's cache. */
+void tritjs_mul_cache_stats(T81CacheStats *out) {
+    if (out) mul_cache_sum(t81_ctx()->cache, out);
+}
+
+/* Drops every product the current context has cached and resets the
+   counters. */
+void tritjs_mul_cache_clear(void) {
+    mul_cache_drop(t81_ctx()->cache);
+}
+
+/* --- Contexts --- */
+/* A context holds what independent computations should not share: the
+   product cache, the ctx tuning keys (memory backend and threshold, cache
+   budget, threads), counters and the error log. Each thread works in the
+   context it last bound with tritjs_context_use(), else in the process
+   default, which follows the tuning file and holds the cache legacy
+   callers have always shared. One context may be bound on several
+   threads; its cache is locked and its counters atomic. Worker threads
+   the library starts run in their caller's context. The constant cache
+   and scratch arenas are not per context: constants are the same
+   everywhere, and each thread already has its own arena. Values may move
+   between contexts freely. */
+static T81Context t81_ctx_default = { .tuning = &t81_tuning, .cache = mul_cache };
+static __thread T81Context *t81_ctx_bound = NULL;
+
+static T81Context* t81_ctx(void) {
+    return t81_ctx_bound ? t81_ctx_bound : &t81_ctx_default;
+}
+
+/* A context with an empty cache and a copy of the process tuning. */
+T81Context* tritjs_context_new(void) {
+    t81_tuning_init();
+    T81Context *ctx = (T81Context*)calloc(1, sizeof(*ctx));
+    MulCacheShard *cache = (MulCacheShard*)calloc(MUL_CACHE_SHARDS, sizeof(*cache));
+    if (!ctx || !cache) {
+        free(ctx);
+        free(cache);
+        return NULL;
+    }
+    for (int i = 0; i < MUL_CACHE_SHARDS; i++) pthread_mutex_init(&cache[i].lock, NULL);
+    ctx->own = t81_tuning;
+    ctx->tuning = &ctx->own;
+    ctx->cache = cache;
+    return ctx;
+}
+
+/* Frees ctx and its cache. It must not be in use on another thread; the
+   calling thread falls back to the default if it had ctx bound. */
+void tritjs_context_free(T81Context* ctx) {
+    if (!ctx || ctx == &t81_ctx_default) return;
+    if (t81_ctx_bound == ctx) t81_ctx_bound = NULL;
+    mul_cache_drop(ctx->cache);
+    for (int i = 0; i < MUL_CACHE_SHARDS; i++) pthread_mutex_destroy(&ctx->cache[i].lock);
+    free(ctx->cache);
+    free(ctx);
+}
+
+/* Binds ctx (NULL for the default) to the calling thread and returns the
+   context that was bound, so a caller can restore it. */
+T81Context* tritjs_context_use(T81Context* ctx) {
+    T81Context *prev = t81_ctx();
+    t81_ctx_bound = (ctx == &t81_ctx_default) ? NULL : ctx;
+    return prev;
+}
+
+/* Sets one ctx tuning key (see the tuning file) in ctx, or in the calling
+   thread's context when ctx is NULL. */
+TritError tritjs_context_set(T81Context* ctx, const char *key, size_t value) {
+    if (!key) return 2;
+    t81_tuning_init();
+    if (!ctx) ctx = t81_ctx();
+    for (size_t i = 0; i < T81_TUNING_KEYS; i++) {
+        if (!t81_tuning_keys[i].ctx || strcmp(key, t81_tuning_keys[i].key) != 0) continue;
+        if (value < t81_tuning_keys[i].min) return 2;
+        size_t off = (size_t)((char*)t81_tuning_keys[i].val - (char*)&t81_tuning);
+        *(size_t*)((char*)ctx->tuning + off) = value;
+        return 0;
+    }
+    return 2;
+}
+
+/* Sends ctx's error log to log, or back to the audit log when NULL. */
+void tritjs_context_set_log(T81Context* ctx, FILE* log) {
+    if (!ctx) ctx = t81_ctx();
+    ctx->log = log;
+}
+
+void tritjs_context_stats(T81Context* ctx, T81ContextStats* out) {
+    if (!out) return;
+    if (!ctx) ctx = t81_ctx();
+    mul_cache_sum(ctx->cache, &out->cache);
+    out->maps = __atomic_load_n(&ctx->maps, __ATOMIC_RELAXED);
+    out->unmaps = __atomic_load_n(&ctx->unmaps, __ATOMIC_RELAXED);
+    out->mapped_bytes = __atomic_load_n(&ctx->mapped_bytes, __ATOMIC_RELAXED);
+    out->errors = __atomic_load_n(&ctx->errors, __ATOMIC_RELAXED);
+}
+
+/* *out = x in O(1): the copy shares x's buffer until either value is
+   next written, which then pays for its own private buffer. x is only
+   marked as shared, but must not be copied from two threads at once. */
+TritError tritjs_copy(T81BigInt* x, T81BigInt** out) {
+    if (!x || !out) return 2;
+    *out = (T81BigInt*)calloc(1, sizeof(T81BigInt));
+    if (!*out) return 1;
+    TritError e = t81bigint_share(*out, x);
+    if (e) { free(*out); *out = NULL; }
+    return e;
+}
+
+TritError tritjs_mul_into(T81BigInt* dst, const T81BigInt* a, const T81BigInt* b) {
+    if (!dst || !a || !b) return 2;
+    return multiply_with_cache(a, b, dst);
+}
+
+TritError tritjs_multiply_big(T81BigInt* a, T81BigInt* b, T81BigInt** result) {
+    if (!a || !b) return 2;
+    *result = (T81BigInt*)calloc(1, sizeof(T81BigInt));
+    if (!*result) return 1;
+    TritError e = multiply_with_cache(a, b, *result);
+    if (e) { free(*result); *result = NULL; }
+    return e;
+}
+
+/* a^2 through the squaring kernels, which form each cross product once. */
+TritError tritjs_square_big(T81BigInt* a, T81BigInt** result) {
+    return tritjs_multiply_big(a, a, result);
+}
+
+/* --- Multiplication Benchmarks and Tuning --- */
+/* Times each multiplication tier forced at the top level (recursion still
+   goes through the dispatcher) over a sweep of sizes and reports where each
+   tier starts beating the one below it. `tritjs --tune` turns those
+   crossovers into the runtime cutoffs and saves them. */
+enum { T81_BENCH_TIERS = 5 };
+
+typedef void (*T81MulKernel)(const T81Limb *A, const T81Limb *B, size_t n, T81Limb *out);
+
+static void bench_naive(const T81Limb *A, const T81Limb *B, size_t n, T81Limb *out) {
+    naive_mul(A, n, B, n, out);
+}
+
+static void bench_ntt(const T81Limb *A, const T81Limb *B, size_t n, T81Limb *out) {
+    t81_ntt_mul(A, n, B, n, out);
+}
+
+static double t81_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Seconds per call: the batch size is doubled until a batch takes 10ms,
+   and the best of five such batches is kept to shed scheduling noise. */
+static double bench_kernel(T81MulKernel f, const T81Limb *A, const T81Limb *B, size_t n, T81Limb *out) {
+    long reps = 1;
+    double best = 0;
+    for (int round = 0; round < 5; round++) {
+        double t;
+        for (;;) {
+            double t0 = t81_now();
+            for (long i = 0; i < reps; i++) f(A, B, n, out);
+            t = (t81_now() - t0) / reps;
+            if (t * reps > 0.01 || reps >= (1L << 24)) break;
+            reps *= 2;
+        }
+        if (round == 0 || t < best) best = t;
+    }
+    return best;
+}
+
+/* Prints the timing table and the tier plan; cross[k] receives the size
+   from which the dispatcher should use tier k, or SIZE_MAX if never. */
+static TritError t81_bench_sweep(FILE *out, size_t cross[T81_BENCH_TIERS]) {
+    static const size_t sizes[] = { 8, 12, 16, 24, 32, 48, 64, 96, 128, 160, 192, 256,
+                                    320, 384, 512, 768, 1024, 1536, 2048, 3072, 4096,
+                                    6144, 8192 };
+    enum { NSIZES = sizeof(sizes) / sizeof(sizes[0]), NTIERS = T81_BENCH_TIERS };
+    static const char *names[NTIERS] = { "schoolbook", "karatsuba", "toom3", "toom4", "ntt" };
+    static const T81MulKernel kernels[NTIERS] = { bench_naive, karatsuba, toom3, toom4, bench_ntt };
+    /* Tiers are only timed where they are plausible contenders. */
+    static const size_t lo[NTIERS] = { 0, 0, 0, 0, 64 };
+    static const size_t hi[NTIERS] = { 1024, SIZE_MAX, SIZE_MAX, SIZE_MAX, SIZE_MAX };
+    double t[NSIZES][NTIERS];
+    size_t nmax = sizes[NSIZES - 1];
+    T81Limb *A = malloc(nmax * sizeof(T81Limb));
+    T81Limb *B = malloc(nmax * sizeof(T81Limb));
+    T81Limb *P = malloc(2 * nmax * sizeof(T81Limb));
+    if (!A || !B || !P) { free(A); free(B); free(P); return 1; }
+    t81_tuning_init();
+    for (size_t i = 0; i < nmax; i++) {
+        A[i] = (((T81Limb)rand() << 42) ^ ((T81Limb)rand() << 21) ^ (T81Limb)rand()) % T81_LIMB_BASE;
+        B[i] = (((T81Limb)rand() << 42) ^ ((T81Limb)rand() << 21) ^ (T81Limb)rand()) % T81_LIMB_BASE;
+    }
+    fprintf(out, "%8s", "limbs");
+    for (int k = 0; k < NTIERS; k++) fprintf(out, " %12s", names[k]);
+    fprintf(out, "   (microseconds per n x n product)\n");
+    for (int s = 0; s < NSIZES; s++) {
+        size_t n = sizes[s];
+        fprintf(out, "%8zu", n);
+        for (int k = 0; k < NTIERS; k++) {
+            if (n < lo[k] || n > hi[k]) {
+                t[s][k] = -1;
+                fprintf(out, " %12s", "-");
+                continue;
+            }
+            if (t81_arena_reserve(toom4_own_scratch(n) + t81_mul_scratch(n) + t81_ntt_scratch(2 * n))) {
+                free(A); free(B); free(P);
+                return 1;
+            }
+            t[s][k] = bench_kernel(kernels[k], A, B, n, P);
+            fprintf(out, " %12.2f", t[s][k] * 1e6);
+        }
+        fprintf(out, "\n");
+    }
+    /* The dispatcher picks a tier from nondecreasing cutoffs, so the plan
+       gives each size one tier, never lower than the tier of a smaller
+       size, minimizing the summed time relative to the fastest tier at
+       each size. Every tier is thus weighed against whichever tier would
+       really run there, and sizes where a tier was not timed cannot go
+       to it. cost[s][k] is the best plan for sizes 0..s ending on k. */
+    double cost[NSIZES][NTIERS];
+    int from[NSIZES][NTIERS];
+    for (int s = 0; s < NSIZES; s++) {
+        double best = -1;
+        for (int k = 0; k < NTIERS; k++)
+            if (t[s][k] >= 0 && (best < 0 || t[s][k] < best)) best = t[s][k];
+        for (int k = 0; k < NTIERS; k++) {
+            cost[s][k] = -1;
+            from[s][k] = k;
+            if (t[s][k] < 0) continue;
+            double prev = 0;
+            if (s > 0) {
+                prev = -1;
+                for (int j = 0; j <= k; j++)
+                    if (cost[s - 1][j] >= 0 && (prev < 0 || cost[s - 1][j] < prev)) {
+                        prev = cost[s - 1][j];
+                        from[s][k] = j;
+                    }
+                if (prev < 0) continue;
+            }
+            cost[s][k] = prev + t[s][k] / best;
+        }
+    }
+    int plan[NSIZES], last = 0;
+    for (int k = 1; k < NTIERS; k++)
+        if (cost[NSIZES - 1][k] >= 0 && (cost[NSIZES - 1][last] < 0 || cost[NSIZES - 1][k] < cost[NSIZES - 1][last]))
+            last = k;
+    for (int s = NSIZES - 1; s >= 0; s--) {
+        plan[s] = last;
+        last = from[s][last];
+    }
+    /* A tier the plan skips starts where the next used tier does, so the
+       cutoffs stay ordered and the tiers above it stay reachable. */
+    for (int k = NTIERS - 1; k >= 1; k--) {
+        cross[k] = (k + 1 < NTIERS) ? cross[k + 1] : SIZE_MAX;
+        for (int s = 0; s < NSIZES; s++)
+            if (plan[s] == k) { cross[k] = sizes[s]; break; }
+    }
+    cross[0] = 0;
+    for (int k = 1; k < NTIERS; k++) {
+        int used = 0;
+        for (int s = 0; s < NSIZES; s++) used |= plan[s] == k;
+        if (used)
+            fprintf(out, "%s from %zu limbs (%zu trits)\n", names[k], cross[k], cross[k] * T81_LIMB_TRITS);
+        else
+            fprintf(out, "%s: not used within %zu limbs\n", names[k], nmax);
+    }
+    free(A); free(B); free(P);
+    tritjs_scratch_release();
+    return 0;
+}
+
+/* Times large products on one thread and on the caller's thread count,
+   each in a private context so the caller's settings and cache are left
+   alone. */
+static void t81_bench_parallel(FILE *out) {
+    static const size_t sizes[] = { 4096, 16384, 65536, 262144 };
+    size_t threads = t81_thread_count(), nmax = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+    T81Limb *A = malloc(nmax * sizeof(T81Limb));
+    T81Limb *B = malloc(nmax * sizeof(T81Limb));
+    T81Limb *P = malloc(2 * nmax * sizeof(T81Limb));
+    T81Context *ctx = tritjs_context_new();
+    if (!A || !B || !P || !ctx) {
+        tritjs_context_free(ctx);
+        free(A); free(B); free(P);
+        return;
+    }
+    for (size_t i = 0; i < nmax; i++) {
+        A[i] = (((T81Limb)rand() << 42) ^ ((T81Limb)rand() << 21) ^ (T81Limb)rand()) % T81_LIMB_BASE;
+        B[i] = (((T81Limb)rand() << 42) ^ ((T81Limb)rand() << 21) ^ (T81Limb)rand()) % T81_LIMB_BASE;
+    }
+    T81Context *prev = tritjs_context_use(ctx);
+    fprintf(out, "%8s %12s %12s %8s   (milliseconds per n x n product, %zu threads)\n",
+            "limbs", "1 thread", "parallel", "speedup", threads);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        double t[2];
+        if (t81_arena_reserve(t81_mul_any_scratch(n, n))) break;
+        for (int k = 0; k < 2; k++) {
+            tritjs_context_set(ctx, "threads", k ? threads : 1);
+            double best = 0;
+            for (int round = 0; round < 3; round++) {
+                double t0 = t81_now();
+                t81_mul(P, A, n, B, n);
+                t0 = t81_now() - t0;
+                if (round == 0 || t0 < best) best = t0;
+            }
+            t[k] = best;
+        }
+        fprintf(out, "%8zu %12.2f %12.2f %7.2fx\n", n, t[0] * 1e3, t[1] * 1e3, t[0] / t[1]);
+    }
+    tritjs_context_use(prev);
+    tritjs_context_free(ctx);
+    free(A); free(B); free(P);
+    tritjs_scratch_release();
+}
+
+void tritjs_bench_multiply(FILE *out) {
+    size_t cross[T81_BENCH_TIERS];
+    if (t81_bench_sweep(out, cross) == 0) t81_bench_parallel(out);
+}
+
+/* Measures the crossovers on this machine, adopts them, and writes them to
+   path (or the default tuning file when path is NULL). A tier the plan
+   never uses gets the cutoff of the next tier up, or SIZE_MAX past the top.
+   The *_bytes keys are memory policy rather than speed crossovers, and the
+   division cutoffs, thread count and par_mul are not part of the
+   multiplication sweep, so their current values are written back
+   unchanged. */
+TritError tritjs_tune(const char *path, FILE *out) {
+    size_t cross[T81_BENCH_TIERS];
+    char buf[512];
+    if (t81_bench_sweep(out, cross)) return 1;
+    t81_tuning.karatsuba = (cross[1] == SIZE_MAX) ? SIZE_MAX : (cross[1] > 3) ? cross[1] - 1 : 3;
+    t81_tuning.toom3 = cross[2];
+    t81_tuning.toom4 = cross[3];
+    t81_tuning.ntt = cross[4];
+    if (!path) path = t81_tuning_path(buf, sizeof(buf));
+    if (!path) return 2;
+    TritError e = tritjs_save_tuning(path);
+    if (!e) fprintf(out, "wrote %s\n", path);
+    return e;
+}
+
+/* --- Batch Arithmetic --- */
+/* One operation over many independent values, with no allocation per
+   value: the result layout is sized in one pass, the output buffers grow
+   at most once, and every value is then computed in place. Result value i
+   gets the slot its operands could need (one limb past the longer for
+   sums, both lengths for products) and len[i] records what it uses, so
+   results may leave slack between values. Groups of four values that are
+   one limb on both sides, which covers every int64_t, take AVX2 lanes
+   for sums, differences and comparisons. */
+
+/* Grows b to hold n values and `limbs` limbs, keeping its contents. */
+TritError tritjs_batch_reserve(T81Batch* b, size_t n, size_t limbs) {
+    if (!b) return 2;
+    if (n > b->slots) {
+        size_t slots = b->slots * 2 > n ? b->slots * 2 : n;
+        size_t *off = realloc(b->off, slots * sizeof(size_t));
+        if (!off) return 1;
+        b->off = off;
+        size_t *len = realloc(b->len, slots * sizeof(size_t));
+        if (!len) return 1;
+        b->len = len;
+        unsigned char *sign = realloc(b->sign, slots);
+        if (!sign) return 1;
+        b->sign = sign;
+        b->slots = slots;
+    }
+    if (limbs > b->capacity) {
+        size_t cap = b->capacity * 2 > limbs ? b->capacity * 2 : limbs;
+        T81Limb *grown = realloc(b->limbs, cap * sizeof(T81Limb));
+        if (!grown) return 1;
+        b->limbs = grown;
+        b->capacity = cap;
+    }
+    return 0;
+}
+
+void tritjs_batch_free(T81Batch* b) {
+    if (!b) return;
+    free(b->limbs);
+    free(b->off);
+    free(b->len);
+    free(b->sign);
+    memset(b, 0, sizeof(*b));
+}
+
+/* Appends a copy of x. */
+TritError tritjs_batch_push(T81Batch* b, const T81BigInt* x) {
+    if (!b || !x || x->len == 0) return 2;
+    if (tritjs_batch_reserve(b, b->n + 1, b->used + x->len)) return 1;
+    memcpy(b->limbs + b->used, x->limbs, x->len * sizeof(T81Limb));
+    b->off[b->n] = b->used;
+    b->len[b->n] = x->len;
+    b->sign[b->n] = (unsigned char)x->sign;
+    b->used += x->len;
+    b->n++;
+    return 0;
+}
+
+TritError tritjs_batch_get(const T81Batch* b, size_t i, T81BigInt** out) {
+    if (!b || !out || i >= b->n) return 2;
+    *out = (T81BigInt*)calloc(1, sizeof(T81BigInt));
+    if (!*out) return 1;
+    if (allocate_digits(*out, b->len[i])) { free(*out); *out = NULL; return 1; }
+    memcpy((*out)->limbs, b->limbs + b->off[i], b->len[i] * sizeof(T81Limb));
+    (*out)->sign = b->sign[i] != 0;
+    t81bigint_normalize(*out);
+    return 0;
+}
+
+/* Every int64_t magnitude is at most 2^63 < 3^40, so each value is one
+   limb and the conversions never divide. */
+TritError tritjs_batch_from_int64(const int64_t* v, size_t n, T81Batch* out) {
+    if (!out || (!v && n)) return 2;
+    if (tritjs_batch_reserve(out, n, n)) return 1;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t m = (uint64_t)(v[i] >> 63);
+        out->limbs[i] = ((uint64_t)v[i] ^ m) - m;
+        out->off[i] = i;
+        out->len[i] = 1;
+        out->sign[i] = (unsigned char)(m & 1);
+    }
+    out->n = n;
+    out->used = n;
+    return 0;
+}
+
+/* Values outside int64_t are stored as 0 and make the call return 4; the
+   rest are converted regardless. */
+TritError tritjs_batch_to_int64(const T81Batch* b, int64_t* out) {
+    if (!b || (!out && b->n)) return 2;
+    TritError e = 0;
+    for (size_t i = 0; i < b->n; i++) {
+        const T81Limb *x = b->limbs + b->off[i];
+        size_t n = b->len[i];
+        while (n > 1 && x[n - 1] == 0) n--;
+        int neg = b->sign[i] != 0;
+        if (n > 1 || x[0] > (T81Limb)INT64_MAX + neg) {
+            out[i] = 0;
+            e = 4;
+            continue;
+        }
+        out[i] = (int64_t)(neg ? 0 - x[0] : x[0]);
+    }
+    return e;
+}
+
+/* Sizes out for one result per operand pair; *scratch receives the arena
+   limbs the largest product needs. */
+static TritError batch_layout(const T81Batch *a, const T81Batch *b, T81Batch *out,
+                              int product, size_t *scratch) {
+    if (!a || !b || !out || a->n != b->n || out == a || out == b) return 2;
+    size_t n = a->n, used = 0, need = 0;
+    if (tritjs_batch_reserve(out, n, 0)) return 1;
+    for (size_t i = 0; i < n; i++) {
+        size_t an = a->len[i], bn = b->len[i];
+        if (an == 0 || bn == 0) return 2;
+        out->off[i] = used;
+        if (product) {
+            used += an + bn;
+            size_t s = an >= bn ? t81_mul_any_scratch(an, bn) : t81_mul_any_scratch(bn, an);
+            if (s > need) need = s;
+        } else {
+            used += (an > bn ? an : bn) + 1;
+        }
+    }
+    if (tritjs_batch_reserve(out, n, used)) return 1;
+    out->n = n;
+    out->used = used;
+    if (scratch) *scratch = need;
+    return 0;
+}
+
+static void batch_addsub_one(const T81Batch *a, const T81Batch *b, T81Batch *out, size_t i, int sub) {
+    int sign;
+    out->len[i] = limbs_add_signed(out->limbs + out->off[i],
+                                   a->limbs + a->off[i], a->len[i], a->sign[i] != 0,
+                                   b->limbs + b->off[i], b->len[i], (b->sign[i] != 0) ^ sub, &sign);
+    out->sign[i] = (unsigned char)sign;
+}
+
+static int batch_cmp_one(const T81Batch *a, const T81Batch *b, size_t i) {
+    const T81Limb *x = a->limbs + a->off[i], *y = b->limbs + b->off[i];
+    size_t xn = a->len[i], yn = b->len[i];
+    int sx = a->sign[i] && cmp_limbs(x, xn, NULL, 0) != 0;
+    int sy = b->sign[i] && cmp_limbs(y, yn, NULL, 0) != 0;
+    if (sx != sy) return sx ? -1 : 1;
+    int c = cmp_limbs(x, xn, y, yn);
+    return sx ? -c : c;
+}
+
+#if defined(__x86_64__)
+/* All-ones in each lane whose sign byte is set. */
+__attribute__((target("avx2")))
+static inline __m256i batch_sign_mask(const unsigned char *s) {
+    int32_t w;
+    memcpy(&w, s, sizeof(w));
+    __m256i v = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(w));
+    return _mm256_xor_si256(_mm256_cmpeq_epi64(v, _mm256_setzero_si256()), _mm256_set1_epi64x(-1));
+}
+
+/* Whether values i..i+3 are one limb in both a and b. */
+__attribute__((target("avx2")))
+static inline int batch_single_limbs(const T81Batch *a, const T81Batch *b, size_t i) {
+    const __m256i one = _mm256_set1_epi64x(1);
+    __m256i x = _mm256_loadu_si256((const __m256i*)(a->len + i));
+    __m256i y = _mm256_loadu_si256((const __m256i*)(b->len + i));
+    __m256i m = _mm256_and_si256(_mm256_cmpeq_epi64(x, one), _mm256_cmpeq_epi64(y, one));
+    return _mm256_movemask_pd(_mm256_castsi256_pd(m)) == 15;
+}
+
+/* Four sign-magnitude sums per step. Like signs add with a carry when
+   x >= 3^40 - y, as in limbs_addsub_avx2; unlike signs take the larger
+   magnitude less the smaller. Each result slot is two limbs, and four
+   such slots are contiguous, so the low and high limbs interleave into
+   two plain stores. Returns how many values it handled. */
+__attribute__((target("avx2")))
+static size_t batch_addsub_avx2(const T81Batch *a, const T81Batch *b, T81Batch *out, int sub) {
+    const __m256i base = _mm256_set1_epi64x((long long)T81_LIMB_BASE);
+    const __m256i bias = _mm256_set1_epi64x((long long)(1ULL << 63));
+    const __m256i ones = _mm256_set1_epi64x(-1);
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i flip = sub ? ones : zero;
+    size_t i = 0;
+    for (; i + 4 <= a->n; i += 4) {
+        if (!batch_single_limbs(a, b, i)) {
+            for (size_t k = i; k < i + 4; k++) batch_addsub_one(a, b, out, k, sub);
+            continue;
+        }
+        __m256i x = _mm256_i64gather_epi64((const long long*)a->limbs,
+                                           _mm256_loadu_si256((const __m256i*)(a->off + i)), 8);
+        __m256i y = _mm256_i64gather_epi64((const long long*)b->limbs,
+                                           _mm256_loadu_si256((const __m256i*)(b->off + i)), 8);
+        __m256i sx = batch_sign_mask(a->sign + i);
+        __m256i sy = _mm256_xor_si256(batch_sign_mask(b->sign + i), flip);
+        __m256i xb = _mm256_xor_si256(x, bias), yb = _mm256_xor_si256(y, bias);
+        __m256i gt = _mm256_cmpgt_epi64(xb, yb), lt = _mm256_cmpgt_epi64(yb, xb);
+        __m256i same = _mm256_cmpeq_epi64(sx, sy);
+        __m256i carry = _mm256_xor_si256(_mm256_cmpgt_epi64(_mm256_xor_si256(_mm256_sub_epi64(base, y), bias), xb), ones);
+        __m256i sum = _mm256_sub_epi64(_mm256_add_epi64(x, y), _mm256_and_si256(carry, base));
+        __m256i diff = _mm256_blendv_epi8(_mm256_sub_epi64(y, x), _mm256_sub_epi64(x, y), gt);
+        __m256i lo = _mm256_blendv_epi8(diff, sum, same);
+        __m256i hi = _mm256_and_si256(_mm256_and_si256(same, carry), one);
+        __m256i neg = _mm256_blendv_epi8(_mm256_or_si256(_mm256_and_si256(gt, sx), _mm256_and_si256(lt, sy)), sx, same);
+        neg = _mm256_andnot_si256(_mm256_cmpeq_epi64(_mm256_or_si256(lo, hi), zero), neg);
+        __m256i even = _mm256_unpacklo_epi64(lo, hi), odd = _mm256_unpackhi_epi64(lo, hi);
+        T81Limb *r = out->limbs + out->off[i];
+        _mm256_storeu_si256((__m256i*)r, _mm256_permute2x128_si256(even, odd, 0x20));
+        _mm256_storeu_si256((__m256i*)(r + 4), _mm256_permute2x128_si256(even, odd, 0x31));
+        _mm256_storeu_si256((__m256i*)(out->len + i), _mm256_add_epi64(one, hi));
+        int m = _mm256_movemask_pd(_mm256_castsi256_pd(neg));
+        for (int k = 0; k < 4; k++) out->sign[i + k] = (unsigned char)((m >> k) & 1);
+    }
+    return i;
+}
+
+/* Four comparisons per step: unlike signs decide by sign (a zero
+   magnitude counts as positive), like signs by magnitude, reversed when
+   both are negative. */
+__attribute__((target("avx2")))
+static size_t batch_cmp_avx2(const T81Batch *a, const T81Batch *b, int *out) {
+    const __m256i bias = _mm256_set1_epi64x((long long)(1ULL << 63));
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i pick = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    size_t i = 0;
+    for (; i + 4 <= a->n; i += 4) {
+        if (!batch_single_limbs(a, b, i)) {
+            for (size_t k = i; k < i + 4; k++) out[k] = batch_cmp_one(a, b, k);
+            continue;
+        }
+        __m256i x = _mm256_i64gather_epi64((const long long*)a->limbs,
+                                           _mm256_loadu_si256((const __m256i*)(a->off + i)), 8);
+        __m256i y = _mm256_i64gather_epi64((const long long*)b->limbs,
+                                           _mm256_loadu_si256((const __m256i*)(b->off + i)), 8);
+        __m256i sx = _mm256_andnot_si256(_mm256_cmpeq_epi64(x, zero), batch_sign_mask(a->sign + i));
+        __m256i sy = _mm256_andnot_si256(_mm256_cmpeq_epi64(y, zero), batch_sign_mask(b->sign + i));
+        __m256i xb = _mm256_xor_si256(x, bias), yb = _mm256_xor_si256(y, bias);
+        __m256i mag = _mm256_sub_epi64(_mm256_cmpgt_epi64(yb, xb), _mm256_cmpgt_epi64(xb, yb));
+        mag = _mm256_blendv_epi8(mag, _mm256_sub_epi64(zero, mag), sx);
+        __m256i c = _mm256_blendv_epi8(mag, _mm256_or_si256(sx, one), _mm256_xor_si256(sx, sy));
+        c = _mm256_permutevar8x32_epi32(c, pick);
+        _mm_storeu_si128((__m128i*)(out + i), _mm256_castsi256_si128(c));
+    }
+    return i;
+}
+#endif
+
+static TritError batch_addsub(const T81Batch *a, const T81Batch *b, T81Batch *out, int sub) {
+    TritError e = batch_layout(a, b, out, 0, NULL);
+    if (e) return e;
+    size_t i = 0;
+#if defined(__x86_64__)
+    if (t81_have_avx2()) i = batch_addsub_avx2(a, b, out, sub);
+#endif
+    for (; i < a->n; i++) batch_addsub_one(a, b, out, i, sub);
+    return 0;
+}
+
+/* out must be zeroed or hold a live batch other than a or b. */
+TritError tritjs_batch_add(const T81Batch* a, const T81Batch* b, T81Batch* out) {
+    return batch_addsub(a, b, out, 0);
+}
+
+TritError tritjs_batch_sub(const T81Batch* a, const T81Batch* b, T81Batch* out) {
+    return batch_addsub(a, b, out, 1);
+}
+
+/* Products skip the product cache, whose lookups would cost more than
+   most batch products. One-limb pairs are a single 128-bit multiply. */
+TritError tritjs_batch_mul(const T81Batch* a, const T81Batch* b, T81Batch* out) {
+    size_t scratch;
+    t81_tuning_init();
+    TritError e = batch_layout(a, b, out, 1, &scratch);
+    if (e) return e;
+    if (t81_arena_reserve(scratch)) return 1;
+    for (size_t i = 0; i < a->n; i++) {
+        const T81Limb *x = a->limbs + a->off[i], *y = b->limbs + b->off[i];
+        size_t xn = a->len[i], yn = b->len[i], n = xn + yn;
+        T81Limb *r = out->limbs + out->off[i];
+        if (n == 2) r[1] = t81_limb_split((T81DLimb)x[0] * y[0], &r[0]);
+        else if (xn >= yn) t81_mul(r, x, xn, y, yn);
+        else t81_mul(r, y, yn, x, xn);
+        while (n > 1 && r[n - 1] == 0) n--;
+        out->len[i] = n;
+        out->sign[i] = (n > 1 || r[0]) && ((a->sign[i] != 0) != (b->sign[i] != 0));
+    }
+    return 0;
+}
+
+/* out[i] is -1, 0 or 1 as value i of a is below, equal to or above value
+   i of b. */
+TritError tritjs_batch_compare(const T81Batch* a, const T81Batch* b, int* out) {
+    if (!a || !b || a->n != b->n || (!out && a->n)) return 2;
+    size_t i = 0;
+#if defined(__x86_64__)
+    if (t81_have_avx2()) i = batch_cmp_avx2(a, b, out);
+#endif
+    for (; i < a->n; i++) out[i] = batch_cmp_one(a, b, i);
+    return 0;
+}
+
+/* Times n random 32-bit operations through the one-value calls, which
+   allocate every operand and result, against the same work as batches. */
+void tritjs_bench_batch(FILE *out, size_t n) {
+    static const char *names[] = { "from_int", "add", "sub", "mul", "compare", "to_int" };
+    int64_t *v = malloc(2 * n * sizeof(int64_t));
+    int *c = malloc(n * sizeof(int));
+    T81BigInt **x = calloc(2 * n, sizeof(T81BigInt*));
+    T81Batch A, B, R;
+    memset(&A, 0, sizeof(A));
+    memset(&B, 0, sizeof(B));
+    memset(&R, 0, sizeof(R));
+    if (!n || !v || !c || !x) { free(v); free(c); free(x); return; }
+    for (size_t i = 0; i < 2 * n; i++) v[i] = (int32_t)(((uint32_t)rand() << 16) ^ (uint32_t)rand());
+    double t[6][2];
+    volatile int sink;
+    for (int k = 0; k < 6; k++) t[k][0] = t[k][1] = -1;
+    double t0 = t81_now();
+    for (size_t i = 0; i < 2 * n; i++) binary_to_trit((int)v[i], &x[i]);
+    t[0][0] = t81_now() - t0;
+    TritError (*ops[])(T81BigInt*, T81BigInt*, T81BigInt**) = {
+        tritjs_add_big, tritjs_subtract_big, tritjs_multiply_big };
+    for (int k = 0; k < 3; k++) {
+        t0 = t81_now();
+        for (size_t i = 0; i < n; i++) {
+            T81BigInt *r = NULL;
+            if (x[i] && x[n + i] && ops[k](x[i], x[n + i], &r) == 0) tritbig_free(r);
+        }
+        t[1 + k][0] = t81_now() - t0;
+    }
+    t0 = t81_now();
+    for (size_t i = 0; i < n; i++) {
+        int r;
+        if (x[i] && trit_to_binary(x[i], &r) == 0) sink = r;
+    }
+    (void)sink;
+    t[5][0] = t81_now() - t0;
+    for (size_t i = 0; i < 2 * n; i++) tritbig_free(x[i]);
+    t0 = t81_now();
+    tritjs_batch_from_int64(v, n, &A);
+    tritjs_batch_from_int64(v + n, n, &B);
+    t[0][1] = t81_now() - t0;
+    TritError (*batch_ops[])(const T81Batch*, const T81Batch*, T81Batch*) = {
+        tritjs_batch_add, tritjs_batch_sub, tritjs_batch_mul };
+    for (int k = 0; k < 3; k++) {
+        t0 = t81_now();
+        batch_ops[k](&A, &B, &R);
+        t[1 + k][1] = t81_now() - t0;
+    }
+    t0 = t81_now();
+    tritjs_batch_compare(&A, &B, c);
+    t[4][1] = t81_now() - t0;
+    t0 = t81_now();
+    tritjs_batch_to_int64(&A, v);
+    t[5][1] = t81_now() - t0;
+    fprintf(out, "%-9s %12s %12s   (ms for %zu values)\n", "op", "single", "batch", n);
+    for (int k = 0; k < 6; k++) {
+        fprintf(out, "%-9s", names[k]);
+        for (int j = 0; j < 2; j++) {
+            if (t[k][j] < 0) fprintf(out, " %12s", "-");
+            else fprintf(out, " %12.2f", t[k][j] * 1e3);
+        }
+        fprintf(out, "\n");
+    }
+    tritjs_batch_free(&A);
+    tritjs_batch_free(&B);
+    tritjs_batch_free(&R);
+    free(v);
+    free(c);
+    free(x);
+}
+
+/* --- Decimal Conversion --- */
+/* Decimal input is converted by divide and conquer: the digits are split
+   around a cached power 10^(19 * 2^k), both halves are converted
+   recursively and recombined as high * 10^(19 * 2^k) + low. With the
+   tiered multiplier this costs O(M(n) log n) instead of the O(n^2) of
+   feeding digits through Horner's rule one at a time. */
+#define T81_DEC_CHUNK 19                       /* Digits per 10^19 < 3^40 step */
+#define T81_DEC_CHUNK_POW 10000000000000000000ULL
+#define T81_DEC_BASECASE (T81_DEC_CHUNK * 32)
+
+static T81BigInt t81_pow10_cache[48];
+static int t81_pow10_levels = 0;
+static pthread_mutex_t t81_pow10_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* 10^(19 * 2^k), built by repeated squaring on first use and kept. Levels
+   are never modified once published, so callers may read them unlocked. */
+static const T81BigInt* t81_pow10(int k) {
+    pthread_mutex_lock(&t81_pow10_lock);
+    while (t81_pow10_levels <= k) {
+        T81BigInt *p = &t81_pow10_cache[t81_pow10_levels];
+        TritError e;
+        if (t81_pow10_levels == 0) {
+            e = allocate_digits(p, 1);
+            if (!e) p->limbs[0] = T81_DEC_CHUNK_POW;
+        } else {
+            const T81BigInt *prev = &t81_pow10_cache[t81_pow10_levels - 1];
+            e = t81bigint_fast_multiply(prev, prev, p);
+        }
+        if (e) { t81bigint_free(p); break; }
+        t81_pow10_levels++;
+    }
+    const T81BigInt *r = (t81_pow10_levels > k) ? &t81_pow10_cache[k] : NULL;
+    pthread_mutex_unlock(&t81_pow10_lock);
+    return r;
+}
+
+/* Horner's rule over 19-digit chunks, for short digit runs. */
+static TritError dec_basecase(const char *s, size_t n, T81BigInt *out) {
+    if (allocate_digits(out, n / T81_DEC_CHUNK + 2)) return 1;
+    size_t len = 1;
+    size_t take = n % T81_DEC_CHUNK ? n % T81_DEC_CHUNK : T81_DEC_CHUNK;
+    for (size_t i = 0; i < n; i += take, take = T81_DEC_CHUNK) {
+        T81Limb chunk = 0, scale = 1;
+        for (size_t k = 0; k < take; k++) {
+            chunk = chunk * 10 + (T81Limb)(s[i + k] - '0');
+            scale *= 10;
+        }
+        T81Limb carry = limbs_mul_1(out->limbs, out->limbs, len, scale);
+        if (carry) out->limbs[len++] = carry;
+        carry = limbs_add_1(out->limbs, out->limbs, len, chunk);
+        if (carry) out->limbs[len++] = carry;
+    }
+    out->len = len;
+    out->sign = 0;
+    return 0;
+}
+
+/* out (zeroed) = the n decimal digits at s. */
+static TritError dec_to_limbs(const char *s, size_t n, T81BigInt *out) {
+    if (n <= T81_DEC_BASECASE) return dec_basecase(s, n, out);
+    int k = 0;
+    while (((size_t)T81_DEC_CHUNK << (k + 1)) < n) k++;
+    size_t lo_n = (size_t)T81_DEC_CHUNK << k;
+    const T81BigInt *p = t81_pow10(k);
+    if (!p) return 1;
+    T81BigInt hi, lo;
+    memset(&hi, 0, sizeof(hi));
+    memset(&lo, 0, sizeof(lo));
+    TritError e = dec_to_limbs(s, n - lo_n, &hi);
+    if (!e) e = dec_to_limbs(s + n - lo_n, lo_n, &lo);
+    if (!e) e = t81bigint_fast_multiply(&hi, p, out);
+    if (!e) e = add_signed_into(out, out, &lo, 0);
+    t81bigint_free(&hi);
+    t81bigint_free(&lo);
+    return e;
+}
+
+/* Parses an optionally negative decimal integer. */
+TritError tritjs_parse_decimal(const char* s, T81BigInt** out) {
+    if (!s || !out) return 2;
+    int sign = 0;
+    if (*s == '-') { sign = 1; s++; }
+    size_t n = strlen(s);
+    if (n == 0) return 2;
+    for (size_t i = 0; i < n; i++)
+        if (s[i] < '0' || s[i] > '9') return 2;
+    while (n > 1 && *s == '0') { s++; n--; }
+    *out = (T81BigInt*)calloc(1, sizeof(T81BigInt));
+    if (!*out) return 1;
+    TritError e = dec_to_limbs(s, n, *out);
+    if (e) { tritbig_free(*out); *out = NULL; return e; }
+    (*out)->sign = sign;
+    t81bigint_normalize(*out);
+    return 0;
+}
+
+/* --- Factorial and Power Functions --- */
+/* n! = 3^v * F(n): v = sum floor(n/3^i) counts the factors of three, and
+   F(n) is what remains. With n_i = floor(n/3^i) and R(lo, hi) the product
+   of the integers in (lo, hi] prime to 3, F(n) = prod R(n_(i+1), n_i)^(i+1),
+   which two running products build from the top level down. Each R comes
+   from a balanced product tree, so the fast multiplies see operands of
+   equal size, and the power of three is a limb offset plus one single-limb
+   multiply. */
+#define T81_FACT_LEAF 32             /* Integers per product tree leaf */
+#define T81_FACT_PAR_MIN 16384       /* Smallest range handed to a thread */
+
+typedef struct {
+    uint64_t lo, hi;
+    int depth;
+    T81Context *ctx;
+    T81BigInt out;
+    TritError err;
+} FactTask;
+
+/* x *= m for a single limb m, growing x by the carry limb. */
+static TritError t81bigint_mul_limb(T81BigInt *x, T81Limb m) {
+    if (t81bigint_reserve(x, x->len + 1)) return 1;
+    x->limbs[x->len] = limbs_mul_1(x->limbs, x->limbs, x->len, m);
+    if (x->limbs[x->len]) x->len++;
+    return 0;
+}
+
+/* out = R(lo, hi), gathering factors into one limb before each multiply. */
+static TritError fact_leaf(uint64_t lo, uint64_t hi, T81BigInt *out) {
+    if (allocate_digits(out, 1)) return 1;
+    out->limbs[0] = 1;
+    out->sign = 0;
+    T81Limb acc = 1;
+    for (uint64_t m = lo + 1; m <= hi; m++) {
+        if (m % 3 == 0) continue;
+        if (acc > (T81_LIMB_BASE - 1) / m) {
+            if (t81bigint_mul_limb(out, acc)) return 1;
+            acc = 1;
+        }
+        acc *= m;
+    }
+    return t81bigint_mul_limb(out, acc);
+}
+
+static TritError fact_range(uint64_t lo, uint64_t hi, int depth, T81BigInt *out);
+
+static void* fact_range_thread(void *arg) {
+    FactTask *t = (FactTask*)arg;
+    tritjs_context_use(t->ctx);
+    t->err = fact_range(t->lo, t->hi, t->depth, &t->out);
+    tritjs_scratch_release();
+    return NULL;
+}
+
+/* out = R(lo, hi). While depth allows, the lower half runs on a new thread
+   and the upper half on this one. */
+static TritError fact_range(uint64_t lo, uint64_t hi, int depth, T81BigInt *out) {
+    if (hi - lo <= T81_FACT_LEAF) return fact_leaf(lo, hi, out);
+    uint64_t mid = lo + (hi - lo) / 2;
+    FactTask t;
+    memset(&t, 0, sizeof(t));
+    t.lo = lo; t.hi = mid; t.depth = depth - 1; t.ctx = t81_ctx();
+    pthread_t th;
+    TritError e;
+    if (depth > 0 && hi - lo >= T81_FACT_PAR_MIN &&
+        pthread_create(&th, NULL, fact_range_thread, &t) == 0) {
+        e = fact_range(mid, hi, depth - 1, out);
+        pthread_join(th, NULL);
+        if (!e) e = t.err;
+    } else {
+        e = fact_range(lo, mid, 0, &t.out);
+        if (!e) e = fact_range(mid, hi, 0, out);
+    }
+    if (!e) e = t81bigint_fast_multiply(&t.out, out, out);
+    t81bigint_free(&t.out);
+    return e;
+}
+
+TritError tritjs_factorial_big(T81BigInt* a, T81BigInt** result) {
+    if (!a || !result) return 2;
+    size_t an = a->len;
+    while (an > 1 && a->limbs[an - 1] == 0) an--;
+    if (an > 1) return 4;
+    uint64_t n = a->limbs[0];
+    if (a->sign && n) return 6;
+    /* log_B n! < n log_B n; refuse what could not be sized. */
+    if (n > 1 && (double)n * log((double)n) / log((double)T81_LIMB_BASE) >
+                 (double)(SIZE_MAX / (4 * sizeof(T81Limb)))) return 4;
+    uint64_t v = 0, ns[42];
+    int levels = 0;
+    for (uint64_t m = n; m; m /= 3) { ns[levels++] = m; v += m / 3; }
+    ns[levels] = 0;
+    int depth = 0;
+    for (size_t th = t81_thread_count(); (1UL << depth) < th; ) depth++;
+    T81BigInt p, r, q;
+    memset(&p, 0, sizeof(p)); memset(&r, 0, sizeof(r)); memset(&q, 0, sizeof(q));
+    TritError e = allocate_digits(&p, 1) || allocate_digits(&r, 1) ? 1 : 0;
+    if (!e) p.limbs[0] = r.limbs[0] = 1;
+    for (int i = levels - 1; !e && i >= 0; i--) {
+        e = fact_range(ns[i + 1], ns[i], depth, &q);
+        if (!e) e = t81bigint_fast_multiply(&p, &q, &p);
+        if (!e) e = t81bigint_fast_multiply(&r, &p, &r);
+    }
+    t81bigint_free(&p);
+    t81bigint_free(&q);
+    T81BigInt *res = NULL;
+    if (!e) {
+        res = (T81BigInt*)calloc(1, sizeof(T81BigInt));
+        size_t at = (size_t)(v / T81_LIMB_TRITS);
+        if (!res || allocate_digits(res, at + r.len + 1)) e = 1;
+        else {
+            res->limbs[at + r.len] = limbs_mul_1(res->limbs + at, r.limbs, r.len,
+                                                 t81_pow3((int)(v % T81_LIMB_TRITS)));
+            t81bigint_normalize(res);
+        }
+    }
+    t81bigint_free(&r);
+    if (e) { tritbig_free(res); return e; }
+    *result = res;
+    return 0;
+}
+
+/* Odd powers x, x^3, ..., x^(2^k - 1) for a k-bit window, into g[]. */
+static TritError power_window_table(const T81BigInt *x, int k, T81BigInt *g) {
+    if (t81bigint_assign(&g[0], x)) return 1;
+    g[0].sign = 0;
+    if (k == 1) return 0;
+    T81BigInt x2;
+    memset(&x2, 0, sizeof(x2));
+    TritError e = t81bigint_fast_multiply(&g[0], &g[0], &x2);
+    for (int i = 1; !e && i < (1 << (k - 1)); i++)
+        e = t81bigint_fast_multiply(&g[i - 1], &x2, &g[i]);
+    t81bigint_free(&x2);
+    return e;
+}
+
+/* |x|^e for |x| >= 2 by left-to-right sliding windows: every bit costs a
+   squaring and each window of up to k bits one multiply by a precomputed
+   odd power. Both working values are sized up front from e * log_B |x|,
+   which bounds every intermediate product, so the loop never reallocates. */
+static TritError power_sliding_window(const T81BigInt *x, size_t xn, uint64_t e, T81BigInt *out) {
+    double lb = (double)(xn - 1) + log((double)x->limbs[xn - 1] + 1) / log((double)T81_LIMB_BASE);
+    if (lb * (double)e > (double)(SIZE_MAX / (4 * sizeof(T81Limb)))) return 4;
+    size_t cap = (size_t)(lb * (double)e) + 2;
+    int nbits = 64 - __builtin_clzll(e);
+    int k = nbits > 672 ? 6 : nbits > 240 ? 5 : nbits > 80 ? 4 : nbits > 24 ? 3 : nbits > 6 ? 2 : 1;
+    T81BigInt g[32], tmp;
+    memset(g, 0, sizeof(g));
+    memset(&tmp, 0, sizeof(tmp));
+    TritError err = t81bigint_reserve(out, cap) || t81bigint_reserve(&tmp, cap) ? 1 : 0;
+    if (!err) err = power_window_table(x, k, g);
+    int started = 0;
+    for (int i = nbits - 1; !err && i >= 0;) {
+        if (!((e >> i) & 1)) {
+            err = t81bigint_fast_multiply(out, out, &tmp);
+            t81bigint_swap(out, &tmp);
+            i--;
+            continue;
+        }
+        int j = (i - k + 1 > 0) ? i - k + 1 : 0;
+        while (!((e >> j) & 1)) j++;
+        uint64_t w = (e >> j) & ((2ULL << (i - j)) - 1);
+        if (!started) {
+            err = t81bigint_assign(out, &g[w / 2]);
+            started = 1;
+        } else {
+            for (int s = 0; !err && s <= i - j; s++) {
+                err = t81bigint_fast_multiply(out, out, &tmp);
+                t81bigint_swap(out, &tmp);
+            }
+            if (!err) {
+                err = t81bigint_fast_multiply(out, &g[w / 2], &tmp);
+                t81bigint_swap(out, &tmp);
+            }
+        }
+        i = j - 1;
+    }
+    for (int i = 0; i < 32; i++) t81bigint_free(&g[i]);
+    t81bigint_free(&tmp);
+    return err;
+}
+
+/* base^exp for non-negative exp. 0 and +-1 are answered for every exponent.
+   Powers of 3 have a closed form and other bases use the sliding window,
+   but both only for exp < 2^64; larger exponents return 4 (overflow),
+   since the result would not fit in memory anyway. */
+TritError tritjs_power_big(T81BigInt* base, T81BigInt* exp, T81BigInt** result) {
+    if (!base || !exp || !result) return 2;
+    size_t bn = base->len, en = exp->len;
+    while (bn > 1 && base->limbs[bn - 1] == 0) bn--;
+    while (en > 1 && exp->limbs[en - 1] == 0) en--;
+    int ezero = (en == 1 && exp->limbs[0] == 0);
+    if (exp->sign && !ezero) return 6;
+    /* 3^40 is odd, so exp has the parity of its limb sum. */
+    int odd = 0;
+    for (size_t i = 0; i < en; i++) odd ^= (int)(exp->limbs[i] & 1);
+    T81DLimb ev = exp->limbs[0];
+    if (en == 2) ev += (T81DLimb)exp->limbs[1] * T81_LIMB_BASE;
+    int efits = (en <= 2 && ev <= UINT64_MAX);
+    T81BigInt *r = (T81BigInt*)calloc(1, sizeof(T81BigInt));
+    if (!r) return 1;
+    TritError err;
+    long k;
+    if (ezero || (bn == 1 && base->limbs[0] <= 1)) {
+        err = allocate_digits(r, 1);
+        if (!err) r->limbs[0] = ezero ? 1 : base->limbs[0];
+    } else if ((k = t81_pow3_exponent(base->limbs, bn)) >= 0) {
+        /* (3^k)^e = 3^(ke): one limb holding 3^(ke mod 40). */
+        T81DLimb t = (T81DLimb)k * (uint64_t)ev;
+        if (!efits || t / T81_LIMB_TRITS >= SIZE_MAX / (2 * sizeof(T81Limb))) {
+            err = 4;
+        } else {
+            size_t at = (size_t)(t / T81_LIMB_TRITS);
+            err = allocate_digits(r, at + 1);
+            if (!err) r->limbs[at] = t81_pow3((int)(t % T81_LIMB_TRITS));
+        }
+    } else {
+        err = efits ? power_sliding_window(base, bn, (uint64_t)ev, r) : 4;
+    }
+    if (err) { tritbig_free(r); return err; }
+    r->sign = (base->sign && odd) ? 1 : 0;
+    t81bigint_normalize(r);
+    *result = r;
+    return 0;
+}
+
+/* --- Full Division and Modulo (Long Division Algorithm) --- */
+/* All limb-level division works on a normalized divisor, whose top limb is
+   at least 3^40 / 2; tritjs_divide_big() scales both operands to get one.
+   Each routine divides a[0..an) by the n-limb b, writes an - n quotient
+   limbs to q, leaves the remainder in a[0..n), zeroes the rest of a, and
+   returns the quotient's top limb (0 or 1). */
+
+/* Knuth, TAOCP vol. 2, 4.3.1 Algorithm D (n >= 2). The two-limb test
+   leaves each estimated quotient limb at most one too large, so a single
+   add-back corrects it. */
+static T81Limb div_qr_basecase(T81Limb *q, T81Limb *a, size_t an, const T81Limb *b, size_t n) {
+    T81Limb qh = 0;
+    if (cmp_limbs(a + an - n, n, b, n) >= 0) {
+        limbs_sub_n(a + an - n, a + an - n, b, n);
+        qh = 1;
+    }
+    T81Limb v1 = b[n - 1], v2 = b[n - 2];
+    for (size_t j = an - n; j-- > 0;) {
+        T81Limb u2 = a[j + n];
+        T81DLimb num = (T81DLimb)u2 * T81_LIMB_BASE + a[j + n - 1];
+        T81Limb qhat = (u2 >= v1) ? T81_LIMB_BASE - 1 : (T81Limb)(num / v1);
+        T81DLimb rhat = num - (T81DLimb)qhat * v1;
+        while (rhat < T81_LIMB_BASE &&
+               (T81DLimb)qhat * v2 > rhat * T81_LIMB_BASE + a[j + n - 2]) {
+            qhat--;
+            rhat += v1;
+        }
+        if (a[j + n] < limbs_submul_1(a + j, b, n, qhat)) {
+            qhat--;
+            limbs_add_n(a + j, a + j, b, n);
+        }
+        a[j + n] = 0;
+        q[j] = qhat;
+    }
+    return qh;
+}
+
+/* 2n by n division in the recursive Burnikel-Ziegler style (as in GMP's
+   dcpi1_div_qr_n): the top half of the quotient comes from dividing by
+   b's high limbs, is corrected against the low limbs with one fast
+   multiply, and the bottom half repeats that on what is left. */
+static T81Limb div_qr_dc_n(T81Limb *q, T81Limb *a, const T81Limb *b, size_t n) {
+    size_t lo = n / 2, hi = n - lo;
+    T81ArenaMark mark = t81_arena_mark();
+    T81Limb *tp = t81_arena_alloc(n);
+    T81Limb qh = (hi < t81_tuning.div_dc) ? div_qr_basecase(q + lo, a + 2 * lo, 2 * hi, b + lo, hi)
+                                          : div_qr_dc_n(q + lo, a + 2 * lo, b + lo, hi);
+    t81_mul(tp, q + lo, hi, b, lo);
+    T81Limb cy = limbs_sub_n(a + lo, a + lo, tp, n);
+    if (qh) cy += limbs_sub_n(a + n, a + n, b, lo);
+    while (cy) {
+        qh -= limbs_sub_1(q + lo, q + lo, hi, 1);
+        cy -= limbs_add_n(a + lo, a + lo, b, n);
+    }
+    T81Limb ql = (lo < t81_tuning.div_dc) ? div_qr_basecase(q, a + hi, 2 * lo, b + hi, lo)
+                                          : div_qr_dc_n(q, a + hi, b + hi, lo);
+    t81_mul(tp, b, hi, q, lo);
+    cy = limbs_sub_n(a, a, tp, n);
+    if (ql) cy += limbs_sub_n(a + lo, a + lo, b, hi);
+    while (cy) {
+        limbs_sub_1(q, q, lo, 1);
+        cy -= limbs_add_n(a, a, b, n);
+    }
+    t81_arena_release(mark);
+    return qh;
+}
+
+/* Any an >= n. A quotient shorter than the divisor is estimated from b's
+   top limbs and corrected like one half of div_qr_dc_n(); a longer one is
+   produced n limbs at a time from the top, each block a 2n by n division
+   whose running remainder stays below b. */
+static T81Limb div_qr(T81Limb *q, T81Limb *a, size_t an, const T81Limb *b, size_t n) {
+    size_t qn = an - n;
+    if (n < t81_tuning.div_dc || qn < t81_tuning.div_dc)
+        return div_qr_basecase(q, a, an, b, n);
+    if (qn < n) {
+        size_t lo = n - qn;
+        T81ArenaMark mark = t81_arena_mark();
+        T81Limb *tp = t81_arena_alloc(n);
+        T81Limb qh = div_qr_dc_n(q, a + lo, b + lo, qn);
+        if (lo >= qn) t81_mul(tp, b, lo, q, qn);
+        else t81_mul(tp, q, qn, b, lo);
+        T81Limb cy = limbs_sub_n(a, a, tp, n);
+        if (qh) cy += limbs_sub_n(a + qn, a + qn, b, lo);
+        while (cy) {
+            qh -= limbs_sub_1(q, q, qn, 1);
+            cy -= limbs_add_n(a, a, b, n);
+        }
+        t81_arena_release(mark);
+        return qh;
+    }
+    size_t off = qn - qn % n;
+    T81Limb qh = (off < qn) ? div_qr(q + off, a + off, n + qn % n, b, n) : 0;
+    while (off) {
+        off -= n;
+        T81Limb h = div_qr_dc_n(q + off, a + off, b, n);
+        if (off + n == qn) qh = h;
+    }
+    return qh;
+}
+
+/* r = -a mod 3^(40n): the complement of a nonzero n-limb value. */
+static void limbs_neg(T81Limb *r, const T81Limb *a, size_t n) {
+    for (size_t i = 0; i < n; i++) r[i] = T81_LIMB_BASE - 1 - a[i];
+    limbs_add_1(r, r, n, 1);
+}
+
+/* inv[0..n] = floor(B^(2n) / b) for a normalized n-limb b, B = 3^40.
+   Newton's step x' = x + x(B^(2n) - bx) / B^(2n) doubles the number of
+   correct limbs, so the reciprocal of b's top half, shifted up, needs one
+   step. What is left is a few units of truncation error, which a final
+   comparison of b*x against B^(2n) removes. */
+static void t81_invert(T81Limb *inv, const T81Limb *b, size_t n) {
+    if (n == 1) {
+        inv[1] = 1;
+        inv[0] = (T81Limb)((T81DLimb)(T81_LIMB_BASE - b[0]) * T81_LIMB_BASE / b[0]);
+        return;
+    }
+    T81ArenaMark mark = t81_arena_mark();
+    if (n < t81_tuning.div_newton) {
+        T81Limb *a = t81_arena_alloc(2 * n + 1);
+        memset(a, 0, 2 * n * sizeof(T81Limb));
+        a[2 * n] = 1;
+        div_qr(inv, a, 2 * n + 1, b, n);
+        t81_arena_release(mark);
+        return;
+    }
+    size_t l = n / 2, h = n - l;
+    memset(inv, 0, l * sizeof(T81Limb));
+    t81_invert(inv + l, b + l, h);
+    /* res = |B^(n+h) - b * xh|, which is below 2 B^n. */
+    T81Limb *res = t81_arena_alloc(n + h + 1);
+    t81_mul(res, b, n, inv + l, h + 1);
+    int over = res[n + h] != 0;
+    if (over) res[n + h]--;
+    else limbs_neg(res, res, n + h);
+    /* x' = x -+ xh * res / B^(2h), an (l + 2)-limb correction. */
+    T81Limb *t = t81_arena_alloc(n + h + 2);
+    t81_mul(t, res, n + 1, inv + l, h + 1);
+    if (over) limbs_sub_1(inv + l + 2, inv + l + 2, h - 1, limbs_sub_n(inv, inv, t + 2 * h, l + 2));
+    else limbs_add_1(inv + l + 2, inv + l + 2, h - 1, limbs_add_n(inv, inv, t + 2 * h, l + 2));
+    /* Settle 0 <= B^(2n) - b*x < b. */
+    T81Limb *p = t81_arena_alloc(2 * n + 1);
+    t81_mul(p, inv, n + 1, b, n);
+    for (;;) {
+        size_t i = 0;
+        while (i < 2 * n && p[i] == 0) i++;
+        if (p[2 * n] == 0 || (p[2 * n] == 1 && i == 2 * n)) break;
+        limbs_sub_1(inv, inv, n + 1, 1);
+        limbs_sub_1(p + n, p + n, n + 1, limbs_sub_n(p, p, b, n));
+    }
+    if (p[2 * n] == 0) {
+        limbs_neg(p, p, 2 * n);
+        while (cmp_limbs(p, 2 * n, b, n) >= 0) {
+            limbs_add_1(inv, inv, n + 1, 1);
+            limbs_sub_1(p + n, p + n, n, limbs_sub_n(p, p, b, n));
+        }
+    }
+    t81_arena_release(mark);
+}
+
+/* Arena limbs t81_invert() needs for an n-limb divisor. */
+static size_t t81_invert_scratch(size_t n) {
+    return 2 * (6 * n + 8 + t81_mul_any_scratch(n + 1, n + 1));
+}
+
+/* div_qr() with a prepared divisor. The quotient is produced from the top
+   in chunks of at most n limbs: each window is the running remainder over
+   the next s limbs of a, and its top s + 1 limbs times the top s + 1
+   limbs of the reciprocal give the chunk's quotient, at most a few units
+   short. Both multiplies are at most (n + 1)-limb. */
+static T81Limb recip_div(T81Limb *q, T81Limb *a, size_t an, const T81Reciprocal *r) {
+    size_t n = r->n, qn = an - n;
+    const T81Limb *b = r->limbs;
+    T81Limb qh = 0;
+    if (cmp_limbs(a + qn, n, b, n) >= 0) {
+        limbs_sub_n(a + qn, a + qn, b, n);
+        qh = 1;
+    }
+    T81ArenaMark mark = t81_arena_mark();
+    T81Limb *tp = t81_arena_alloc(2 * n + 2);
+    for (size_t pos = qn; pos > 0;) {
+        size_t s = (pos % n) ? pos % n : n;
+        pos -= s;
+        T81Limb *w = a + pos, *qk = q + pos;
+        t81_mul(tp, w + n - 1, s + 1, r->inv + n - s, s + 1);
+        memcpy(qk, tp + s + 1, s * sizeof(T81Limb));
+        t81_mul(tp, b, n, qk, s);
+        limbs_sub_n(w, w, tp, n + s);
+        while (cmp_limbs(w, n + s, b, n) >= 0) {
+            limbs_sub_1(w + n, w + n, s, limbs_sub_n(w, w, b, n));
+            limbs_add_1(qk, qk, s, 1);
+        }
+    }
+    t81_arena_release(mark);
+    return qh;
+}
+
+static size_t recip_div_scratch(size_t n) {
+    return 2 * n + 2 + t81_mul_any_scratch(n + 1, n + 1);
+}
+
+void tritjs_reciprocal_free(T81Reciprocal* r) {
+    if (!r) return;
+    free(r->limbs);
+    memset(r, 0, sizeof(*r));
+}
+
+/* Prepares b for tritjs_divide_reciprocal(). r must be zeroed or hold a
+   reciprocal, which is replaced. */
+TritError tritjs_reciprocal_init(T81Reciprocal* r, const T81BigInt* b) {
+    if (!r || !b) return 2;
+    size_t n = b->len;
+    while (n > 0 && b->limbs[n - 1] == 0) n--;
+    if (n == 0) { LOG_ERROR(3, "tritjs_reciprocal_init"); return 3; }
+    t81_tuning_init();
+    T81Limb *buf = (T81Limb*)malloc((2 * n + 1) * sizeof(T81Limb));
+    if (!buf || t81_arena_reserve(t81_invert_scratch(n))) { free(buf); return 1; }
+    tritjs_reciprocal_free(r);
+    r->limbs = buf;
+    r->inv = buf + n;
+    r->n = n;
+    r->scale = T81_LIMB_BASE / (b->limbs[n - 1] + 1);
+    r->sign = b->sign;
+    limbs_mul_1(r->limbs, b->limbs, n, r->scale);
+    t81_invert(r->inv, r->limbs, n);
+    return 0;
+}
+
+/* Q, R = |a| divided by a prepared divisor, as magnitudes. */
+static TritError t81_divide_reciprocal(const T81Limb *a, size_t an, const T81Reciprocal *r, T81BigInt *Q, T81BigInt *R) {
+    size_t n = r->n;
+    if (allocate_digits(Q, an + 1 > n ? an + 1 - n : 1) || allocate_digits(R, n)) return 1;
+    if (an < n) {
+        memcpy(R->limbs, a, an * sizeof(T81Limb));
+        return 0;
+    }
+    if (t81_arena_reserve(an + 1 + recip_div_scratch(n))) return 1;
+    T81ArenaMark mark = t81_arena_mark();
+    T81Limb *na = t81_arena_alloc(an + 1);
+    na[an] = limbs_mul_1(na, a, an, r->scale);
+    recip_div(Q->limbs, na, an + 1, r);
+    limbs_divrem_1(R->limbs, na, n, r->scale);
+    t81_arena_release(mark);
+    return 0;
+}
+
+TritError tritjs_divide_reciprocal(T81BigInt* a, const T81Reciprocal* r, T81BigInt** quotient, T81BigInt** remainder) {
+    if (!a || !r || !r->n || !quotient || !remainder) return 2;
+    T81BigInt *Q = (T81BigInt*)calloc(1, sizeof(T81BigInt));
+    T81BigInt *R = (T81BigInt*)calloc(1, sizeof(T81BigInt));
+    size_t an = a->len;
+    while (an > 1 && a->limbs[an - 1] == 0) an--;
+    TritError e = (Q && R) ? t81_divide_reciprocal(a->limbs, an, r, Q, R) : 1;
+    if (e) {
+        tritbig_free(Q);
+        tritbig_free(R);
+        return e;
+    }
+    Q->sign = (a->sign != r->sign) ? 1 : 0;
+    R->sign = a->sign;
+    t81bigint_normalize(Q);
+    t81bigint_normalize(R);
+    *quotient = Q;
+    *remainder = R;
+    return 0;
+}
+
+/* Whether the cached reciprocal is for b, compared limb by limb against
+   b times the cached scale. */
+static int t81_div_recip_matches(const T81Limb *b, size_t n) {
+    const T81Reciprocal *r = &t81_div_recip;
+    if (r->n != n || r->scale != T81_LIMB_BASE / (b[n - 1] + 1)) return 0;
+    T81Limb carry = 0, lo;
+    for (size_t i = 0; i < n; i++) {
+        carry = t81_limb_split((T81DLimb)b[i] * r->scale + carry, &lo);
+        if (lo != r->limbs[i]) return 0;
+    }
+    return 1;
+}
+
+/* Inverting a divisor costs about one division by it and saves over half
+   of each later one, so it pays for a quotient of several blocks or for a
+   divisor that repeats. A divisor is remembered by a hash when first
+   seen and inverted when seen again. Returns whether t81_div_recip now
+   holds b's reciprocal. */
+static __thread uint64_t t81_div_seen;
+
+static int t81_div_recip_for(const T81BigInt *b, size_t n, size_t qn) {
+    if (t81_div_recip_matches(b->limbs, n)) return 1;
+    uint64_t h = n;
+    for (size_t i = 0; i < n; i++) h = (h ^ b->limbs[i]) * 0x100000001b3ULL;
+    if (qn < 4 * n && h != t81_div_seen) {
+        t81_div_seen = h;
+        return 0;
+    }
+    return tritjs_reciprocal_init(&t81_div_recip, b) == 0;
+}
+
+TritError tritjs_divide_big(T81BigInt* a, T81BigInt* b, T81BigInt** quotient, T81BigInt** remainder) {
+    if (!a || !b || !quotient || !remainder) return 2;
+    size_t n = b->len, an = a->len;
+    while (n > 0 && b->limbs[n - 1] == 0) n--;
+    if (n == 0) { LOG_ERROR(3, "tritjs_divide_big"); return 3; }
+    while (an > 1 && a->limbs[an - 1] == 0) an--;
+    t81_tuning_init();
+    T81BigInt *Q = (T81BigInt*)calloc(1, sizeof(T81BigInt));
+    T81BigInt *R = (T81BigInt*)calloc(1, sizeof(T81BigInt));
+    TritError e = (Q && R) ? 0 : 1;
+    long k;
+    if (!e && cmp_limbs(a->limbs, an, b->limbs, n) < 0) {
+        e = allocate_digits(Q, 1);
+        if (!e) e = allocate_digits(R, an);
+        if (!e) memcpy(R->limbs, a->limbs, an * sizeof(T81Limb));
+    } else if (!e && (k = t81_pow3_exponent(b->limbs, n)) >= 0) {
+        /* b = 3^k: drop k / 40 whole limbs and divide what is left by
+           3^(k % 40); the dropped limbs are the low part of the remainder. */
+        size_t L = n - 1;
+        e = allocate_digits(Q, an - L);
+        if (!e) e = allocate_digits(R, n);
+        if (!e) {
+            memcpy(R->limbs, a->limbs, L * sizeof(T81Limb));
+            R->limbs[L] = limbs_divrem_1(Q->limbs, a->limbs + L, an - L, b->limbs[L]);
+        }
+    } else if (!e && n >= t81_tuning.div_newton && t81_div_recip_for(b, n, an - n)) {
+        e = t81_divide_reciprocal(a->limbs, an, &t81_div_recip, Q, R);
+    } else if (!e && n == 1) {
+        e = allocate_digits(Q, an);
+        if (!e) e = allocate_digits(R, 1);
+        if (!e) R->limbs[0] = limbs_divrem_1(Q->limbs, a->limbs, an, b->limbs[0]);
+    } else if (!e) {
+        /* Scaling by d = floor(3^40 / (top + 1)) lifts the divisor's top limb
+           to at least 3^40 / 2 without lengthening it; a gains one limb, so
+           the quotient's own top limb is always 0. */
+        T81Limb d = T81_LIMB_BASE / (b->limbs[n - 1] + 1);
+        e = allocate_digits(Q, an + 1 - n);
+        if (!e) e = allocate_digits(R, n);
+        if (!e) e = t81_arena_reserve(an + 1 + 3 * n + t81_mul_any_scratch(n, n));
+        if (!e) {
+            T81ArenaMark mark = t81_arena_mark();
+            T81Limb *na = t81_arena_alloc(an + 1), *nb = t81_arena_alloc(n);
+            na[an] = limbs_mul_1(na, a->limbs, an, d);
+            limbs_mul_1(nb, b->limbs, n, d);
+            div_qr(Q->limbs, na, an + 1, nb, n);
+            limbs_divrem_1(R->limbs, na, n, d);
+            t81_arena_release(mark);
+        }
+    }
+    if (e) {
+        tritbig_free(Q);
+        tritbig_free(R);
+        return e;
+    }
+    Q->sign = (a->sign != b->sign) ? 1 : 0;
+    R->sign = a->sign;
+    t81bigint_normalize(Q);
+    t81bigint_normalize(R);
+    *quotient = Q;
+    *remainder = R;
+    return 0;
+}
+
+/* --- Shift Operations --- */
+/* A shift by k trits moves k / 40 whole limbs and shifts the rest by
+   s = k % 40 trits inside one pass: a left shift multiplies by 3^s, and a
+   right shift multiplies by 3^(40 - s) and drops the low limb, which is
+   floor(x / 3^s). Either way the limbs go straight into the result. Right
+   shifts truncate toward zero, matching tritjs_divide_big(). */
+TritError tritjs_left_shift(T81BigInt* a, int shift, T81BigInt** result) {
+    if (!a || !result || shift < 0) return 2;
+    size_t an = a->len, q = (size_t)shift / T81_LIMB_TRITS;
+    int s = shift % T81_LIMB_TRITS;
+    while (an > 1 && a->limbs[an - 1] == 0) an--;
+    if (an == 1 && a->limbs[0] == 0) q = 0;
+    T81BigInt *r = (T81BigInt*)calloc(1, sizeof(T81BigInt));
+    if (!r) return 1;
+    if (allocate_digits(r, an + q + 1)) { tritbig_free(r); return 1; }
+    if (s == 0) memcpy(r->limbs + q, a->limbs, an * sizeof(T81Limb));
+    else r->limbs[an + q] = limbs_mul_1(r->limbs + q, a->limbs, an, t81_pow3(s));
+    r->sign = a->sign;
+    t81bigint_normalize(r);
+    *result = r;
+    return 0;
+}
+
+TritError tritjs_right_shift(T81BigInt* a, int shift, T81BigInt** result) {
+    if (!a || !result || shift < 0) return 2;
+    size_t an = a->len, q = (size_t)shift / T81_LIMB_TRITS;
+    int s = shift % T81_LIMB_TRITS;
+    while (an > 1 && a->limbs[an - 1] == 0) an--;
+    size_t rn = (q < an) ? an - q : 1;
+    T81BigInt *r = (T81BigInt*)calloc(1, sizeof(T81BigInt));
+    if (!r) return 1;
+    if (allocate_digits(r, rn)) { tritbig_free(r); return 1; }
+    if (q < an && s == 0) {
+        memcpy(r->limbs, a->limbs + q, rn * sizeof(T81Limb));
+    } else if (q < an) {
+        const T81Limb *src = a->limbs + q;
+        T81Limb m = t81_pow3(T81_LIMB_TRITS - s), lo;
+        T81Limb carry = t81_limb_split((T81DLimb)src[0] * m, &lo);
+        for (size_t i = 1; i < rn; i++)
+            carry = t81_limb_split((T81DLimb)src[i] * m + carry, &r->limbs[i - 1]);
+        r->limbs[rn - 1] = carry;
+    }
+    r->sign = a->sign;
+    t81bigint_normalize(r);
+    *result = r;
+    return 0;
+}
+
+/* --- Scientific Functions: Fixed-Point Engine --- */
+/* Reals are carried as T81BigInts scaled by 3^(40w), that is w limbs after
+   the point, and every step truncates. Each function works a few guard
+   limbs past the trits it was asked for and cuts the result down to
+   exactly `precision` trits when it is written out as a T81Float. */
+#define T81_FX_GUARD 2               /* Guard limbs past the requested precision */
+#define T81_FX_ITER_MAX 256          /* Cap on AGM steps */
+
+enum { T81_CONST_PI, T81_CONST_E, T81_CONST_LN3, T81_CONSTS };
+static TritError fx_const(int which, T81BigInt *r, size_t w);
+
+static int fx_is_zero(const T81BigInt *x) {
+    return x->len == 1 && x->limbs[0] == 0;
+}
+
+/* r = a * 3^(40k). r must not alias a. */
+static TritError fx_shift_up(T81BigInt *r, const T81BigInt *a, size_t k) {
+    size_t an = a->len;
+    while (an > 1 && a->limbs[an - 1] == 0) an--;
+    if (allocate_digits(r, an + k)) return 1;
+    memcpy(r->limbs + k, a->limbs, an * sizeof(T81Limb));
+    r->sign = a->sign;
+    t81bigint_normalize(r);
+    return 0;
+}
+
+/* r = v as a value with w limbs after the point. */
+static TritError fx_set(T81BigInt *r, T81Limb v, size_t w) {
+    if (allocate_digits(r, w + 1)) return 1;
+    r->limbs[w] = v;
+    r->sign = 0;
+    t81bigint_normalize(r);
+    return 0;
+}
+
+/* x = x / 3^(40k), truncated toward zero. Shifts in place, so a shared
+   buffer is made private first. */
+static TritError fx_drop(T81BigInt *x, size_t k) {
+    TritError e = t81bigint_reserve(x, x->len);
+    if (e) return e;
+    if (x->len <= k) {
+        x->limbs[0] = 0;
+        x->len = 1;
+        x->sign = 0;
+        return 0;
+    }
+    memmove(x->limbs, x->limbs + k, (x->len - k) * sizeof(T81Limb));
+    x->len -= k;
+    t81bigint_normalize(x);
+    return 0;
+}
+
+/* x = x / d for 0 < d < 3^40, truncated toward zero. */
+static TritError fx_div_small(T81BigInt *x, T81Limb d) {
+    TritError e = t81bigint_reserve(x, x->len);
+    if (e) return e;
+    limbs_divrem_1(x->limbs, x->limbs, x->len, d);
+    t81bigint_normalize(x);
+    return 0;
+}
+
+/* x = x / 3^j, truncated toward zero. */
+static TritError fx_div_pow3(T81BigInt *x, int j) {
+    TritError e = 0;
+    for (; !e && j > 0; j -= T81_LIMB_TRITS)
+        e = fx_div_small(x, t81_pow3(j < T81_LIMB_TRITS ? j : T81_LIMB_TRITS));
+    return e;
+}
+
+/* r = a * b at w limbs. r may alias either operand. */
+static TritError fx_mul(T81BigInt *r, const T81BigInt *a, const T81BigInt *b, size_t w) {
+    TritError e = t81bigint_fast_multiply(a, b, r);
+    if (!e) e = fx_drop(r, w);
+    return e;
+}
+
+/* r = a / b at w limbs. */
+static TritError fx_div(T81BigInt *r, const T81BigInt *a, const T81BigInt *b, size_t w) {
+    T81BigInt t;
+    memset(&t, 0, sizeof(t));
+    T81BigInt *q = NULL, *rem = NULL;
+    TritError e = fx_shift_up(&t, a, w);
+    if (!e) e = tritjs_divide_big(&t, (T81BigInt*)b, &q, &rem);
+    if (!e) e = t81bigint_assign(r, q);
+    tritbig_free(q);
+    tritbig_free(rem);
+    t81bigint_free(&t);
+    return e;
+}
+
+/* r = floor(sqrt(|n|)). The root s of the top of n, plus one and moved
+   back up by k limbs, is above the true root and good to about half its
+   limbs. Newton's step x - ceil((x^2 - n) / 2x) started above the root
+   stays above it until it lands on the floor, the first iterate whose
+   square is at most n. While x is still (s + 1) 3^(40k), its square and
+   the division by 2x only involve s, so the first step costs a quarter
+   size division and the check one half size squaring. */
+static TritError t81_isqrt(T81BigInt *r, const T81BigInt *n) {
+    size_t L = n->len;
+    while (L > 1 && n->limbs[L - 1] == 0) L--;
+    if (L <= 2) {
+        T81DLimb v = (L == 2 ? (T81DLimb)n->limbs[1] * T81_LIMB_BASE : 0) + n->limbs[0];
+        T81Limb x = (T81Limb)sqrtl((long double)v);
+        while ((T81DLimb)x * x > v) x--;
+        while ((T81DLimb)(x + 1) * (x + 1) <= v) x++;
+        if (allocate_digits(r, 1)) return 1;
+        r->limbs[0] = x;
+        r->sign = 0;
+        return 0;
+    }
+    size_t k = (L > 9) ? (L - 2) / 4 : 1;
+    T81BigInt top, x, sq, d, m;
+    memset(&top, 0, sizeof(top));
+    memset(&x, 0, sizeof(x));
+    memset(&sq, 0, sizeof(sq));
+    memset(&d, 0, sizeof(d));
+    memset(&m, 0, sizeof(m));
+    T81BigInt *q = NULL, *rem = NULL;
+    T81BigInt nn = *n;
+    nn.len = L;
+    nn.sign = 0;
+    TritError e = allocate_digits(&top, L - 2 * k);
+    if (!e) {
+        memcpy(top.limbs, n->limbs + 2 * k, (L - 2 * k) * sizeof(T81Limb));
+        e = t81_isqrt(&x, &top);
+    }
+    if (!e) e = t81bigint_reserve(&x, x.len + 1);
+    if (!e) {
+        x.limbs[x.len] = limbs_add_1(x.limbs, x.limbs, x.len, 1);
+        if (x.limbs[x.len]) x.len++;
+    }
+    /* The iterate is x 3^(40k); k drops to 0 after the first step. */
+    while (!e) {
+        e = t81bigint_fast_multiply(&x, &x, &m);
+        if (!e) e = fx_shift_up(&sq, &m, 2 * k);
+        if (e || cmp_limbs(sq.limbs, sq.len, nn.limbs, L) <= 0) break;
+        e = tritjs_sub_into(&d, &sq, &nn);
+        if (!e) e = fx_set(&m, 1, 0);
+        if (!e) e = tritjs_sub_into(&d, &d, &m);
+        if (!e) e = fx_drop(&d, k);
+        if (!e) e = t81bigint_assign(&m, &x);
+        if (!e) e = t81bigint_mul_limb(&m, 2);
+        if (!e) e = tritjs_divide_big(&d, &m, &q, &rem);
+        if (!e) e = fx_shift_up(&m, &x, k);
+        if (!e) e = tritjs_sub_into(&m, &m, q);
+        if (!e) e = fx_set(&d, 1, 0);
+        if (!e) e = tritjs_sub_into(&x, &m, &d);
+        tritbig_free(q);
+        tritbig_free(rem);
+        q = rem = NULL;
+        k = 0;
+    }
+    if (!e) e = fx_shift_up(r, &x, k);
+    t81bigint_free(&top);
+    t81bigint_free(&x);
+    t81bigint_free(&sq);
+    t81bigint_free(&d);
+    t81bigint_free(&m);
+    return e;
+}
+
+/* r = sqrt(a) at w limbs, for a >= 0. */
+static TritError fx_sqrt(T81BigInt *r, const T81BigInt *a, size_t w) {
+    T81BigInt t;
+    memset(&t, 0, sizeof(t));
+    TritError e = fx_shift_up(&t, a, w);
+    if (!e) e = t81_isqrt(r, &t);
+    t81bigint_free(&t);
+    return e;
+}
+
+/* r = AGM(a, b) at w limbs for a, b > 0; a and b are overwritten. The
+   loop stops once they agree to the last limb, where one more arithmetic
+   mean is within (a - b)^2 of the limit. */
+static TritError fx_agm(T81BigInt *r, T81BigInt *a, T81BigInt *b, size_t w) {
+    T81BigInt d, t;
+    memset(&d, 0, sizeof(d));
+    memset(&t, 0, sizeof(t));
+    TritError e = 0;
+    for (int i = 0; !e && i < T81_FX_ITER_MAX; i++) {
+        e = tritjs_sub_into(&d, a, b);
+        if (e || d.len <= 1) break;
+        e = fx_mul(&t, a, b, w);
+        if (!e) e = tritjs_add_into(a, a, b);
+        if (!e) e = fx_div_small(a, 2);
+        if (!e) e = fx_sqrt(b, &t, w);
+    }
+    if (!e) e = tritjs_add_into(r, a, b);
+    if (!e) e = fx_div_small(r, 2);
+    t81bigint_free(&d);
+    t81bigint_free(&t);
+    return e;
+}
+
+/* r = ln(s) at w limbs for an integer s >= 3^(40(w/2 + 2)), from
+   ln s = pi / (2 AGM(1, 4/s)), whose error is below s^-2. The AGM is
+   homogeneous, so it is taken of (s/4, 1) instead, which keeps the small
+   argument exact: ln s = pi s / (8 AGM(s/4, 1)). */
+static TritError fx_ln_big(T81BigInt *r, const T81BigInt *s, const T81BigInt *pi, size_t w) {
+    T81BigInt a, b, m, t;
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+    memset(&m, 0, sizeof(m));
+    memset(&t, 0, sizeof(t));
+    TritError e = fx_shift_up(&a, s, w);
+    if (!e) e = fx_div_small(&a, 4);
+    if (!e) e = fx_set(&b, 1, w);
+    if (!e) e = fx_agm(&m, &a, &b, w);
+    if (!e) e = t81bigint_fast_multiply(pi, s, &t);
+    if (!e) e = fx_div(r, &t, &m, w);
+    if (!e) e = fx_div_small(r, 8);
+    t81bigint_free(&a);
+    t81bigint_free(&b);
+    t81bigint_free(&m);
+    t81bigint_free(&t);
+    return e;
+}
+
+/* (2n)(2n + 1): the ratio of consecutive odd factorials. */
+static T81Limb fx_sin_ratio(size_t n) {
+    return (T81Limb)(2 * n) * (2 * n + 1);
+}
+
+/* s = sin y at w limbs for |y| < 3^(2 - j), from the N terms of
+   y sum (-1)^n z^n / (2n + 1)!, z = y^2, that reach 3^(-40w). The sum is
+   split into blocks of m ~ sqrt(N) terms (Smith's method): with z^0..z^m
+   stored, each block is a run of single-limb divisions and additions,
+   and only the Horner step joining blocks multiplies by z^m, so the
+   series takes about 2 sqrt(N) full multiplies instead of N. */
+static TritError fx_sin_series(T81BigInt *s, const T81BigInt *y, size_t w, int j) {
+    size_t N = 1;
+    while ((2.0 - j) * (2 * N + 1) - lgamma(2.0 * N + 2) / log(3.0) > -(double)(T81_LIMB_TRITS * w) - 1)
+        N++;
+    size_t m = (size_t)sqrt((double)N) + 1, blocks = (N + m - 1) / m;
+    T81BigInt *pw = calloc(m + 1, sizeof(T81BigInt));
+    T81BigInt acc, tot;
+    memset(&acc, 0, sizeof(acc));
+    memset(&tot, 0, sizeof(tot));
+    if (!pw) return 1;
+    TritError e = fx_set(&pw[0], 1, w);
+    if (!e) e = fx_mul(&pw[1], y, y, w);
+    for (size_t i = 2; !e && i <= m; i++)
+        e = fx_mul(&pw[i], &pw[i - 1], &pw[1], w);
+    for (size_t b = blocks; !e && b-- > 0;) {
+        size_t base = b * m, cnt = (N - base < m) ? N - base : m;
+        e = fx_set(&acc, 0, w);
+        for (size_t i = cnt; !e && i-- > 0;) {
+            if (i + 1 < cnt) e = fx_div_small(&acc, fx_sin_ratio(base + i + 1));
+            if (!e) e = (i & 1) ? tritjs_sub_into(&acc, &acc, &pw[i]) : tritjs_add_into(&acc, &acc, &pw[i]);
+        }
+        if (e || b + 1 == blocks) {
+            if (!e) e = t81bigint_assign(&tot, &acc);
+            continue;
+        }
+        e = fx_mul(&tot, &tot, &pw[m], w);
+        for (size_t k = 1; !e && k <= m; k++) {
+            T81Limb d = fx_sin_ratio(base + k);
+            if (k < m && d <= (T81_LIMB_BASE - 1) / fx_sin_ratio(base + k + 1))
+                d *= fx_sin_ratio(base + ++k);
+            e = fx_div_small(&tot, d);
+        }
+        if (!e && (m & 1) && !fx_is_zero(&tot)) tot.sign ^= 1;
+        if (!e) e = tritjs_add_into(&tot, &tot, &acc);
+    }
+    if (!e) e = fx_mul(s, y, &tot, w);
+    for (size_t i = 0; i <= m; i++) t81bigint_free(&pw[i]);
+    free(pw);
+    t81bigint_free(&acc);
+    t81bigint_free(&tot);
+    return e;
+}
+
+/* s, c = sin x, cos x at w limbs for |x| <= pi. x is divided by 3^j;
+   sin of that comes from its series and cos from sqrt(1 - s^2), which
+   does not cancel at so small an angle. Both are then tripled back j
+   times with sin 3y = s(3 - 4s^2) and cos 3y = c(4c^2 - 3). Tripling
+   multiplies the cosine's error by up to 9 a step, so w must carry 2j
+   guard trits. */
+static TritError fx_sincos(T81BigInt *s, T81BigInt *c, const T81BigInt *x, size_t w, int j) {
+    T81BigInt y, t, one, three;
+    memset(&y, 0, sizeof(y));
+    memset(&t, 0, sizeof(t));
+    memset(&one, 0, sizeof(one));
+    memset(&three, 0, sizeof(three));
+    TritError e = t81bigint_assign(&y, x);
+    if (!e) e = fx_div_pow3(&y, j);
+    if (!e) e = fx_sin_series(s, &y, w, j);
+    if (!e) e = fx_set(&one, 1, w);
+    if (!e) e = fx_mul(&t, s, s, w);
+    if (!e) e = tritjs_sub_into(&t, &one, &t);
+    if (!e) e = fx_sqrt(c, &t, w);
+    if (!e) e = fx_set(&three, 3, w);
+    for (int i = 0; !e && i < j; i++) {
+        e = fx_mul(&t, s, s, w);
+        if (!e) e = t81bigint_mul_limb(&t, 4);
+        if (!e) e = tritjs_sub_into(&t, &three, &t);
+        if (!e) e = fx_mul(s, s, &t, w);
+        if (!e) e = fx_mul(&t, c, c, w);
+        if (!e) e = t81bigint_mul_limb(&t, 4);
+        if (!e) e = tritjs_sub_into(&t, &t, &three);
+        if (!e) e = fx_mul(c, c, &t, w);
+    }
+    t81bigint_free(&y);
+    t81bigint_free(&t);
+    t81bigint_free(&one);
+    t81bigint_free(&three);
+    return e;
+}
+
+/* s, c = sin a, cos a for an integer a, at *w limbs chosen for
+   `precision` trits. a is reduced into [-pi, pi] against a pi carrying
+   as many extra limbs as a has, so the reduction loses nothing. Taking
+   j near cbrt(P) / 2 balances the series' 2 sqrt(P / 2j) multiplies and
+   its single-limb steps against the four multiplies per tripling. */
+static TritError t81_sincos(const T81BigInt *a, int precision, T81BigInt *s, T81BigInt *c, size_t *w) {
+    int j = (int)(cbrt((double)precision) / 2) + 1;
+    size_t an = a->len;
+    while (an > 1 && a->limbs[an - 1] == 0) an--;
+    *w = ((size_t)precision + 2 * j) / T81_LIMB_TRITS + 1 + T81_FX_GUARD;
+    size_t wr = *w + an;
+    T81BigInt pi, x;
+    memset(&pi, 0, sizeof(pi));
+    memset(&x, 0, sizeof(x));
+    T81BigInt *q = NULL, *rem = NULL;
+    TritError e = fx_const(T81_CONST_PI, &pi, wr);
+    if (!e) e = fx_shift_up(&x, a, wr);
+    if (!e) e = t81bigint_mul_limb(&pi, 2);
+    if (!e) e = tritjs_divide_big(&x, &pi, &q, &rem);
+    if (!e) e = fx_div_small(&pi, 2);
+    if (!e) {
+        if (cmp_limbs(rem->limbs, rem->len, pi.limbs, pi.len) > 0) {
+            e = t81bigint_mul_limb(&pi, 2);
+            if (!e) e = rem->sign ? tritjs_add_into(rem, rem, &pi) : tritjs_sub_into(rem, rem, &pi);
+        }
+    }
+    if (!e) e = fx_drop(rem, an);
+    if (!e) e = fx_sincos(s, c, rem, *w, j);
+    tritbig_free(q);
+    tritbig_free(rem);
+    t81bigint_free(&pi);
+    t81bigint_free(&x);
+    return e;
+}
+
+void tritjs_float_free(T81Float* f) {
+    if (!f) return;
+    if (f->i_mapped && f->integer) {
+        munmap(f->integer, f->i_len ? f->i_len : 1);
+        close(f->i_fd);
+    } else {
+        free(f->integer);
+    }
+    if (f->f_mapped && f->fraction) {
+        munmap(f->fraction, f->f_len ? f->f_len : 1);
+        close(f->f_fd);
+    } else {
+        free(f->fraction);
+    }
+    memset(f, 0, sizeof(*f));
 }
 
-/* --- Arithmetic Operations: Addition and Subtraction --- */
-static int cmp_base81(const unsigned char* a, size_t a_len,
-                      const unsigned char* b, size_t b_len) {
-    if (a_len > b_len) {
-        for (size_t i = a_len - 1; i >= b_len; i--) {
-            if (a[i] != 0) return 1;
-            if (i == 0) break;
-        }
-    } else if (b_len > a_len) {
-        for (size_t i = b_len - 1; i >= a_len; i--) {
-            if (b[i] != 0) return -1;
-            if (i == 0) break;
+void tritjs_complex_free(T81Complex* c) {
+    if (!c) return;
+    tritjs_float_free(&c->real);
+    tritjs_float_free(&c->imag);
+}
+
+/* Writes x, held at w limbs, to f truncated to `precision` trits; a NULL
+   x writes zero. Integer digits run least significant first and fraction
+   digits most significant first, both base 81, so each limb gives ten. */
+static TritError fx_to_float(T81Float *f, const T81BigInt *x, size_t w, int precision) {
+    size_t n = x ? x->len : 0;
+    size_t il = n > w ? n - w : 0, fl = ((size_t)precision + 3) / 4;
+    memset(f, 0, sizeof(*f));
+    f->i_fd = f->f_fd = -1;
+    f->integer = calloc(il ? il * T81_LIMB_DIGITS81 : 1, 1);
+    f->fraction = calloc(fl ? fl : 1, 1);
+    if (!f->integer || !f->fraction) {
+        tritjs_float_free(f);
+        return 1;
+    }
+    int nonzero = 0;
+    f->i_len = 1;
+    for (size_t i = 0; i < il; i++) {
+        T81Limb v = x->limbs[w + i];
+        for (size_t d = i * T81_LIMB_DIGITS81; v; d++, v /= 81) {
+            f->integer[d] = (unsigned char)(v % 81);
+            if (f->integer[d]) f->i_len = d + 1;
         }
     }
-    size_t m = (a_len < b_len ? a_len : b_len);
-    for (ssize_t i = m - 1; i >= 0; i--) {
-        if (a[i] < b[i]) return -1;
-        if (a[i] > b[i]) return 1;
-        if (i == 0) break;
+    for (size_t d = 0; d < fl; d += T81_LIMB_DIGITS81) {
+        size_t li = d / T81_LIMB_DIGITS81;
+        T81Limb v = (li < w && w - 1 - li < n) ? x->limbs[w - 1 - li] : 0;
+        for (size_t k = T81_LIMB_DIGITS81; k-- > 0; v /= 81)
+            if (d + k < fl) f->fraction[d + k] = (unsigned char)(v % 81);
     }
+    if (fl && precision % 4) {
+        unsigned char m = (unsigned char)t81_pow3(4 - precision % 4);
+        f->fraction[fl - 1] = f->fraction[fl - 1] / m * m;
+    }
+    f->f_len = fl;
+    for (size_t d = 0; d < f->i_len; d++) nonzero |= f->integer[d];
+    for (size_t d = 0; d < fl; d++) nonzero |= f->fraction[d];
+    f->sign = (x && x->sign && nonzero) ? 1 : 0;
     return 0;
 }
 
-TritError tritjs_add_big(T81BigInt* A, T81BigInt* B, T81BigInt** result) {
-    if (!A || !B) return 2;
-    *result = (T81BigInt*)calloc(1, sizeof(T81BigInt));
-    if (!*result) return 1;
-    if (A->sign == B->sign) {
-        (*result)->sign = A->sign;
-        size_t len = (A->len > B->len ? A->len : B->len) + 1;
-        if (allocate_digits(*result, len)) { free(*result); return 1; }
-        memset((*result)->digits, 0, len);
-        memcpy((*result)->digits, A->digits, A->len);
-        for (size_t i = 0; i < B->len; i++) {
-            int val = (*result)->digits[i] + B->digits[i];
-            (*result)->digits[i] = val % BASE_81;
-            int carry = val / BASE_81;
-            size_t cpos = i + 1;
-            while (carry && cpos < len) {
-                val = (*result)->digits[cpos] + carry;
-                (*result)->digits[cpos] = val % BASE_81;
-                carry = val / BASE_81;
-                cpos++;
-            }
-        }
-        while ((*result)->len > 1 && (*result)->digits[(*result)->len - 1] == 0)
-            (*result)->len--;
-    } else {
-        int c = cmp_base81(A->digits, A->len, B->digits, B->len);
-        T81BigInt *larger, *smaller;
-        int largerSign;
-        if (c > 0) { larger = A; smaller = B; largerSign = A->sign; }
-        else if (c < 0) { larger = B; smaller = A; largerSign = B->sign; }
-        else { if (allocate_digits(*result, 1)) { free(*result); return 1; }
-               (*result)->digits[0] = 0; return 0; }
-        (*result)->sign = largerSign;
-        if (allocate_digits(*result, larger->len)) { free(*result); return 1; }
-        memcpy((*result)->digits, larger->digits, larger->len);
-        for (size_t i = 0; i < smaller->len; i++) {
-            int diff = (*result)->digits[i] - smaller->digits[i];
-            if (diff < 0) {
-                diff += BASE_81;
-                size_t j = i + 1;
-                while (1) {
-                    (*result)->digits[j]--;
-                    if ((*result)->digits[j] < (unsigned char)255) break;
-                    (*result)->digits[j] += BASE_81;
-                    j++;
-                    if (j >= larger->len) break;
-                }
-            }
-            (*result)->digits[i] = (unsigned char)diff;
-        }
-        while ((*result)->len > 1 && (*result)->digits[(*result)->len - 1] == 0)
-            (*result)->len--;
+/* result->real + i result->imag = z, each truncated to `precision` trits. */
+static TritError fx_to_complex(T81Complex *result, const T81BigInt *re, const T81BigInt *im, size_t w, int precision) {
+    TritError e = fx_to_float(&result->real, re, w, precision);
+    if (!e) e = fx_to_float(&result->imag, im, w, precision);
+    if (e) tritjs_complex_free(result);
+    return e;
+}
+
+/* The square root is exact: floor(sqrt(|a| 3^(80w))) holds every trit
+   asked for. A negative a gives i sqrt(|a|). */
+TritError tritjs_sqrt_complex(T81BigInt* a, int precision, T81Complex* result) {
+    if (!a || !result) return 2;
+    if (precision < 0) return 7;
+    size_t w = ((size_t)precision + T81_LIMB_TRITS - 1) / T81_LIMB_TRITS;
+    T81BigInt t, r;
+    memset(&t, 0, sizeof(t));
+    memset(&r, 0, sizeof(r));
+    TritError e = fx_shift_up(&t, a, 2 * w);
+    if (!e) e = t81_isqrt(&r, &t);
+    if (!e) e = a->sign ? fx_to_complex(result, NULL, &r, w, precision)
+                        : fx_to_complex(result, &r, NULL, w, precision);
+    t81bigint_free(&t);
+    t81bigint_free(&r);
+    return e;
+}
+
+/* log3 |a| = ln(|a| 3^(40m)) / ln 3 - 40m, where m lifts a past the size
+   the AGM logarithm needs. A negative a adds the principal imaginary part
+   pi / ln 3. */
+TritError tritjs_log3_complex(T81BigInt* a, int precision, T81Complex* result) {
+    if (!a || !result) return 2;
+    if (precision < 0) return 7;
+    if (fx_is_zero(a)) { LOG_ERROR(5, "tritjs_log3_complex"); return 5; }
+    size_t w = ((size_t)precision + T81_LIMB_TRITS - 1) / T81_LIMB_TRITS + T81_FX_GUARD;
+    size_t an = a->len, need = w / 2 + 3;
+    while (an > 1 && a->limbs[an - 1] == 0) an--;
+    size_t m = need > an ? need - an : 0;
+    T81BigInt pi, s, ln, ln3, v, im, t;
+    memset(&pi, 0, sizeof(pi));
+    memset(&s, 0, sizeof(s));
+    memset(&ln, 0, sizeof(ln));
+    memset(&ln3, 0, sizeof(ln3));
+    memset(&v, 0, sizeof(v));
+    memset(&im, 0, sizeof(im));
+    memset(&t, 0, sizeof(t));
+    TritError e = fx_const(T81_CONST_PI, &pi, w);
+    if (!e) e = fx_const(T81_CONST_LN3, &ln3, w);
+    if (!e) e = fx_shift_up(&s, a, m);
+    if (!e) {
+        s.sign = 0;
+        e = fx_ln_big(&ln, &s, &pi, w);
     }
-    return 0;
+    if (!e) e = fx_div(&v, &ln, &ln3, w);
+    if (!e) e = fx_set(&t, (T81Limb)T81_LIMB_TRITS * m, w);
+    if (!e) e = tritjs_sub_into(&v, &v, &t);
+    if (!e && a->sign) e = fx_div(&im, &pi, &ln3, w);
+    if (!e) e = fx_to_complex(result, &v, a->sign ? &im : NULL, w, precision);
+    t81bigint_free(&pi);
+    t81bigint_free(&s);
+    t81bigint_free(&ln);
+    t81bigint_free(&ln3);
+    t81bigint_free(&v);
+    t81bigint_free(&im);
+    t81bigint_free(&t);
+    return e;
 }
 
-TritError tritjs_subtract_big(T81BigInt* A, T81BigInt* B, T81BigInt** result) {
-    if (!A || !B) return 2;
-    T81BigInt tmp = *B;
-    int oldsign = tmp.sign;
-    tmp.sign = !oldsign;
-    TritError e = tritjs_add_big(A, &tmp, result);
-    tmp.sign = oldsign;
+TritError tritjs_sin_complex(T81BigInt* a, int precision, T81Complex* result) {
+    if (!a || !result) return 2;
+    if (precision < 0) return 7;
+    T81BigInt s, c;
+    memset(&s, 0, sizeof(s));
+    memset(&c, 0, sizeof(c));
+    size_t w;
+    TritError e = t81_sincos(a, precision, &s, &c, &w);
+    if (!e) e = fx_to_complex(result, &s, NULL, w, precision);
+    t81bigint_free(&s);
+    t81bigint_free(&c);
     return e;
 }
 
-/* --- Multiplication: Karatsuba with Cache --- */
-#define MUL_CACHE_SIZE 8
-typedef struct {
-    char key[128];
-    T81BigInt result;
-    int used;
-} MulCacheEntry;
-static MulCacheEntry mul_cache[MUL_CACHE_SIZE] = {{0}};
+TritError tritjs_cos_complex(T81BigInt* a, int precision, T81Complex* result) {
+    if (!a || !result) return 2;
+    if (precision < 0) return 7;
+    T81BigInt s, c;
+    memset(&s, 0, sizeof(s));
+    memset(&c, 0, sizeof(c));
+    size_t w;
+    TritError e = t81_sincos(a, precision, &s, &c, &w);
+    if (!e) e = fx_to_complex(result, &c, NULL, w, precision);
+    t81bigint_free(&s);
+    t81bigint_free(&c);
+    return e;
+}
 
-static void naive_mul(const unsigned char *A, size_t alen,
-                      const unsigned char *B, size_t blen,
-                      unsigned char *out) {
-    memset(out, 0, alen + blen);
-    for (size_t i = 0; i < alen; i++) {
-        int carry = 0;
-        for (size_t j = 0; j < blen; j++) {
-            int pos = i + j;
-            int val = out[pos] + A[i] * B[j] + carry;
-            out[pos] = val % BASE_81;
-            carry = val / BASE_81;
+TritError tritjs_tan_complex(T81BigInt* a, int precision, T81Complex* result) {
+    if (!a || !result) return 2;
+    if (precision < 0) return 7;
+    T81BigInt s, c, t;
+    memset(&s, 0, sizeof(s));
+    memset(&c, 0, sizeof(c));
+    memset(&t, 0, sizeof(t));
+    size_t w;
+    TritError e = t81_sincos(a, precision, &s, &c, &w);
+    if (!e && fx_is_zero(&c)) { LOG_ERROR(3, "tritjs_tan_complex"); e = 3; }
+    if (!e) e = fx_div(&t, &s, &c, w);
+    if (!e) e = fx_to_complex(result, &t, NULL, w, precision);
+    t81bigint_free(&s);
+    t81bigint_free(&c);
+    t81bigint_free(&t);
+    return e;
+}
+
+/* Times each scientific function over a sweep of precisions. */
+void tritjs_bench_scientific(FILE *out) {
+    static const int precisions[] = { 100, 1000, 10000, 100000 };
+    static const char *names[] = { "sqrt", "log3", "sin", "cos", "tan" };
+    TritError (*fns[])(T81BigInt*, int, T81Complex*) = {
+        tritjs_sqrt_complex, tritjs_log3_complex, tritjs_sin_complex,
+        tritjs_cos_complex, tritjs_tan_complex };
+    T81BigInt *x = NULL;
+    if (binary_to_trit(12345, &x)) return;
+    fprintf(out, "%-6s", "trits");
+    for (size_t f = 0; f < 5; f++) fprintf(out, " %10s", names[f]);
+    fprintf(out, "   (ms, argument 12345)\n");
+    for (size_t p = 0; p < sizeof(precisions) / sizeof(precisions[0]); p++) {
+        fprintf(out, "%-6d", precisions[p]);
+        for (size_t f = 0; f < 5; f++) {
+            T81Complex c;
+            double t0 = t81_now();
+            TritError e = fns[f](x, precisions[p], &c);
+            double t = t81_now() - t0;
+            if (e) fprintf(out, " %10s", "error");
+            else fprintf(out, " %10.2f", t * 1e3);
+            if (!e) tritjs_complex_free(&c);
         }
-        out[i + blen] += carry;
+        fprintf(out, "\n");
     }
+    tritbig_free(x);
 }
 
-static void add_shifted(unsigned char *dest, size_t dlen,
-                        const unsigned char *src, size_t slen,
-                        size_t shift) {
-    int carry = 0;
-    for (size_t i = 0; i < slen; i++) {
-        size_t idx = i + shift;
-        if (idx >= dlen) break;
-        int sum = dest[idx] + src[i] + carry;
-        dest[idx] = sum % BASE_81;
-        carry = sum / BASE_81;
+/* --- Constants by Binary Splitting --- */
+/* pi, e and ln 3 are sums of series whose terms each carry the ratio
+   p(n)/q(n) of small integers over the one before, weighted by a(n)/b(n).
+   Binary splitting sums terms [lo, hi) as exact integers P, Q, B, T with
+   sum = T / (B Q), merging halves by
+       P = P1 P2,  Q = Q1 Q2,  B = B1 B2,  T = B2 Q2 T1 + B1 P1 T2,
+   so the work is a balanced product tree ending in a few large multiplies
+   and one division. Each constant is cached at the largest precision yet
+   asked for and cut down for smaller requests. */
+#define T81_SERIES_PAR_MIN 1024      /* Smallest term range handed to a thread */
+
+enum { T81_SERIES_CHUDNOVSKY, T81_SERIES_EXP, T81_SERIES_ATANH };
+
+typedef struct {
+    int kind;
+    T81Limb x;                /* atanh(1/x) */
+} T81Series;
+
+typedef struct {
+    T81BigInt P, Q, B, T;
+} T81Split;
+
+typedef struct {
+    const T81Series *s;
+    size_t lo, hi;
+    int depth, need_p;
+    T81Context *ctx;
+    T81Split out;
+    TritError err;
+} SeriesTask;
+
+static T81BigInt t81_const[T81_CONSTS];
+static size_t t81_const_w[T81_CONSTS];
+static pthread_mutex_t t81_const_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void t81_split_free(T81Split *x) {
+    t81bigint_free(&x->P);
+    t81bigint_free(&x->Q);
+    t81bigint_free(&x->B);
+    t81bigint_free(&x->T);
+}
+
+/* Term n on its own. Chudnovsky: p = -(6n-5)(2n-1)(6n-1),
+   q = n^3 640320^3 / 24, a = 13591409 + 545140134n. e: p = 1, q = n.
+   atanh(1/x): p = 1, q = x^2, b = 2n + 1. Term 0 has p = q = 1. */
+static TritError series_leaf(const T81Series *s, size_t n, T81Split *out) {
+    T81Limb q = 1, b = 1, a = 1;
+    if (s->kind == T81_SERIES_CHUDNOVSKY) {
+        a = 13591409 + (T81Limb)545140134 * n;
+        if (n) q = 10939058860032000ULL;
+    } else if (s->kind == T81_SERIES_EXP) {
+        if (n) q = n;
+    } else {
+        if (n) q = s->x * s->x;
+        b = 2 * n + 1;
     }
-    size_t idx = slen + shift;
-    while (carry && idx < dlen) {
-        int sum = dest[idx] + carry;
-        dest[idx] = sum % BASE_81;
-        carry = sum / BASE_81;
-        idx++;
+    TritError e = fx_set(&out->P, 1, 0);
+    if (!e) e = fx_set(&out->Q, q, 0);
+    if (!e) e = fx_set(&out->B, b, 0);
+    if (!e && s->kind == T81_SERIES_CHUDNOVSKY && n) {
+        e = t81bigint_mul_limb(&out->P, 6 * n - 5);
+        if (!e) e = t81bigint_mul_limb(&out->P, 2 * n - 1);
+        if (!e) e = t81bigint_mul_limb(&out->P, 6 * n - 1);
+        out->P.sign = 1;
+        for (int i = 0; !e && i < 3; i++) e = t81bigint_mul_limb(&out->Q, n);
     }
+    if (!e) e = t81bigint_assign(&out->T, &out->P);
+    if (!e) e = t81bigint_mul_limb(&out->T, a);
+    return e;
+}
+
+static TritError series_range(const T81Series *s, size_t lo, size_t hi, int depth, int need_p, T81Split *out);
+
+static void* series_range_thread(void *arg) {
+    SeriesTask *t = (SeriesTask*)arg;
+    tritjs_context_use(t->ctx);
+    t->err = series_range(t->s, t->lo, t->hi, t->depth, t->need_p, &t->out);
+    tritjs_scratch_release();
+    return NULL;
 }
 
-static void sub_inplace(unsigned char* out, const unsigned char* src, size_t length) {
-    int borrow = 0;
-    for (size_t i = 0; i < length; i++) {
-        int diff = out[i] - src[i] - borrow;
-        if (diff < 0) { diff += BASE_81; borrow = 1; }
-        else { borrow = 0; }
-        out[i] = diff;
+/* out = the split of terms [lo, hi). P is only formed where a parent
+   needs it, which leaves it out along the right spine of the tree. While
+   depth allows, the lower half runs on a new thread and the upper half on
+   this one. */
+static TritError series_range(const T81Series *s, size_t lo, size_t hi, int depth, int need_p, T81Split *out) {
+    if (hi - lo == 1) return series_leaf(s, lo, out);
+    size_t mid = lo + (hi - lo) / 2;
+    SeriesTask t;
+    memset(&t, 0, sizeof(t));
+    t.s = s; t.lo = lo; t.hi = mid; t.depth = depth - 1; t.need_p = 1;
+    t.ctx = t81_ctx();
+    pthread_t th;
+    TritError e;
+    if (depth > 0 && hi - lo >= T81_SERIES_PAR_MIN &&
+        pthread_create(&th, NULL, series_range_thread, &t) == 0) {
+        e = series_range(s, mid, hi, depth - 1, need_p, out);
+        pthread_join(th, NULL);
+        if (!e) e = t.err;
+    } else {
+        e = series_range(s, lo, mid, 0, 1, &t.out);
+        if (!e) e = series_range(s, mid, hi, 0, need_p, out);
     }
+    T81Split *l = &t.out;
+    T81BigInt u;
+    memset(&u, 0, sizeof(u));
+    if (!e) e = t81bigint_fast_multiply(&l->T, &out->Q, &u);
+    if (!e) e = t81bigint_fast_multiply(&u, &out->B, &u);
+    if (!e) e = t81bigint_fast_multiply(&l->P, &out->T, &out->T);
+    if (!e) e = t81bigint_fast_multiply(&l->B, &out->T, &out->T);
+    if (!e) e = tritjs_add_into(&out->T, &out->T, &u);
+    if (!e) e = t81bigint_fast_multiply(&l->Q, &out->Q, &out->Q);
+    if (!e) e = t81bigint_fast_multiply(&l->B, &out->B, &out->B);
+    if (!e && need_p) e = t81bigint_fast_multiply(&l->P, &out->P, &out->P);
+    t81bigint_free(&u);
+    t81_split_free(l);
+    return e;
 }
 
-static void karatsuba(const unsigned char *A, const unsigned char *B, size_t n, unsigned char *out) {
-    if (n <= 16) { naive_mul(A, n, B, n, out); return; }
-    size_t half = n / 2, r = n - half;
-    const unsigned char *A0 = A, *A1 = A + half;
-    const unsigned char *B0 = B, *B1 = B + half;
-    size_t len2 = 2 * n;
-    unsigned char *p1 = calloc(len2, 1);
-    unsigned char *p2 = calloc(len2, 1);
-    unsigned char *p3 = calloc(len2, 1);
-    unsigned char *sumA = calloc(r, 1);
-    unsigned char *sumB = calloc(r, 1);
-    karatsuba(A0, B0, half, p1);
-    karatsuba(A1, B1, r, p2);
-    memcpy(sumA, A1, r);
-    for (size_t i = 0; i < half; i++) {
-        int s = sumA[i] + A0[i];
-        sumA[i] = s % BASE_81;
-        int c = s / BASE_81;
-        if (c && i + 1 < r) sumA[i + 1] += c;
-    }
-    memcpy(sumB, B1, r);
-    for (size_t i = 0; i < half; i++) {
-        int s = sumB[i] + B0[i];
-        sumB[i] = s % BASE_81;
-        int c = s / BASE_81;
-        if (c && i + 1 < r) sumB[i + 1] += c;
-    }
-    karatsuba(sumA, sumB, r, p3);
-    sub_inplace(p3, p1, len2);
-    sub_inplace(p3, p2, len2);
-    memset(out, 0, len2);
-    add_shifted(out, len2, p1, len2, 0);
-    add_shifted(out, len2, p3, len2, half);
-    add_shifted(out, len2, p2, len2, 2 * half);
-    free(p1); free(p2); free(p3);
-    free(sumA); free(sumB);
-}
-
-static TritError t81bigint_karatsuba_multiply(const T81BigInt *a, const T81BigInt *b, T81BigInt *out) {
-    if ((a->len == 1 && a->digits[0] == 0) || (b->len == 1 && b->digits[0] == 0)) {
-        if (allocate_digits(out, 1)) return 1;
-        out->digits[0] = 0; out->sign = 0;
-        return 0;
+/* The split of terms [0, n), threaded across the configured workers. */
+static TritError series_sum(const T81Series *s, size_t n, T81Split *out) {
+    int depth = 0;
+    for (size_t th = t81_thread_count(); (1UL << depth) < th; ) depth++;
+    return series_range(s, 0, n, depth, 0, out);
+}
+
+/* r = atanh(1/x) at w limbs; each term is worth 2 log3(x) trits. */
+static TritError fx_atanh_inv(T81BigInt *r, T81Limb x, size_t w) {
+    T81Series s = { T81_SERIES_ATANH, x };
+    T81Split sp;
+    memset(&sp, 0, sizeof(sp));
+    size_t n = (size_t)(T81_LIMB_TRITS * w / (2 * log((double)x) / log(3.0))) + 2;
+    TritError e = series_sum(&s, n, &sp);
+    if (!e) e = t81bigint_fast_multiply(&sp.B, &sp.Q, &sp.P);
+    if (!e) e = t81bigint_mul_limb(&sp.P, x);
+    if (!e) e = fx_div(r, &sp.T, &sp.P, w);
+    t81_split_free(&sp);
+    return e;
+}
+
+/* r = the constant at w limbs. pi = 426880 sqrt(10005) Q / T over the
+   Chudnovsky terms, about 29.7 trits each; e = T / Q over 1/n!; and
+   ln 3 = 228 atanh(1/251) + 86 atanh(1/449) - 60 atanh(1/4801)
+   + 98 atanh(1/8749). */
+static TritError fx_const_compute(int which, T81BigInt *r, size_t w) {
+    T81Split sp;
+    T81BigInt t;
+    memset(&t, 0, sizeof(t));
+    memset(&sp, 0, sizeof(sp));
+    TritError e = 0;
+    if (which == T81_CONST_PI) {
+        T81Series s = { T81_SERIES_CHUDNOVSKY, 0 };
+        e = series_sum(&s, (size_t)(T81_LIMB_TRITS * w / 29.7) + 2, &sp);
+        if (!e) e = fx_set(&t, 10005, w);
+        if (!e) e = fx_sqrt(&sp.P, &t, w);
+        if (!e) e = t81bigint_mul_limb(&sp.Q, 426880);
+        if (!e) e = t81bigint_fast_multiply(&sp.Q, &sp.P, &t);
+        if (!e) e = fx_div(r, &t, &sp.T, 0);
+    } else if (which == T81_CONST_E) {
+        T81Series s = { T81_SERIES_EXP, 0 };
+        size_t n = 2;
+        while (lgamma((double)n + 1) / log(3.0) < (double)(T81_LIMB_TRITS * w) + 2) n++;
+        e = series_sum(&s, n, &sp);
+        if (!e) e = fx_div(r, &sp.T, &sp.Q, w);
+    } else {
+        static const T81Limb xs[4] = { 251, 449, 4801, 8749 }, ks[4] = { 228, 86, 60, 98 };
+        e = fx_set(r, 0, w);
+        for (int i = 0; !e && i < 4; i++) {
+            e = fx_atanh_inv(&t, xs[i], w);
+            if (!e) e = t81bigint_mul_limb(&t, ks[i]);
+            if (!e) e = (i == 2) ? tritjs_sub_into(r, r, &t) : tritjs_add_into(r, r, &t);
+        }
     }
-    size_t n = (a->len > b->len ? a->len : b->len);
-    unsigned char *A = calloc(n, 1), *B = calloc(n, 1);
-    if (!A || !B) { free(A); free(B); return 1; }
-    memcpy(A, a->digits, a->len);
-    memcpy(B, b->digits, b->len);
-    size_t out_len = 2 * n;
-    unsigned char *prod = calloc(out_len, 1);
-    if (!prod) { free(A); free(B); return 1; }
-    karatsuba(A, B, n, prod);
-    free(A); free(B);
-    out->sign = (a->sign != b->sign) ? 1 : 0;
-    while (out_len > 1 && prod[out_len - 1] == 0) out_len--;
-    if (allocate_digits(out, out_len)) { free(prod); return 1; }
-    memcpy(out->digits, prod, out_len);
-    free(prod);
-    return 0;
+    t81_split_free(&sp);
+    t81bigint_free(&t);
+    return e;
 }
 
-static int mul_cache_lookup(const char* key, T81BigInt *dst) {
-    for (int i = 0; i < MUL_CACHE_SIZE; i++) {
-        if (mul_cache[i].used && strcmp(mul_cache[i].key, key) == 0) {
-            if (allocate_digits(dst, mul_cache[i].result.len)) return 1;
-            dst->len = mul_cache[i].result.len;
-            dst->sign = mul_cache[i].result.sign;
-            memcpy(dst->digits, mul_cache[i].result.digits, dst->len);
-            return 0;
+/* r = the constant at w limbs, from the cache when it holds enough. A
+   miss computes an eighth more than asked plus a guard limb, so slowly
+   growing requests do not each recompute. */
+static TritError fx_const(int which, T81BigInt *r, size_t w) {
+    TritError e = 0;
+    pthread_mutex_lock(&t81_const_lock);
+    if (!t81_const[which].limbs || t81_const_w[which] < w) {
+        size_t cw = w + w / 8 + 1;
+        T81BigInt v;
+        memset(&v, 0, sizeof(v));
+        e = fx_const_compute(which, &v, cw + 1);
+        if (!e) e = fx_drop(&v, 1);
+        if (!e) {
+            t81bigint_swap(&t81_const[which], &v);
+            t81bigint_free(&v);
+            t81_const_w[which] = cw;
+        } else {
+            t81bigint_free(&v);
         }
     }
-    return 2;
+    if (!e) e = t81bigint_assign(r, &t81_const[which]);
+    if (!e) e = fx_drop(r, t81_const_w[which] - w);
+    pthread_mutex_unlock(&t81_const_lock);
+    return e;
 }
 
-static void mul_cache_store(const char* key, const T81BigInt *val) {
-    int slot = -1;
-    for (int i = 0; i < MUL_CACHE_SIZE; i++) {
-        if (!mul_cache[i].used) { slot = i; break; }
+void tritjs_const_cache_clear(void) {
+    pthread_mutex_lock(&t81_const_lock);
+    for (int i = 0; i < T81_CONSTS; i++) {
+        t81bigint_free(&t81_const[i]);
+        t81_const_w[i] = 0;
     }
-    if (slot < 0) slot = 0;
-    strncpy(mul_cache[slot].key, key, sizeof(mul_cache[slot].key));
-    mul_cache[slot].key[sizeof(mul_cache[slot].key) - 1] = '\0';
-    t81bigint_free(&mul_cache[slot].result);
-    mul_cache[slot].used = 1;
-    allocate_digits(&mul_cache[slot].result, val->len);
-    mul_cache[slot].result.len = val->len;
-    mul_cache[slot].result.sign = val->sign;
-    memcpy(mul_cache[slot].result.digits, val->digits, val->len);
+    pthread_mutex_unlock(&t81_const_lock);
 }
 
-static TritError multiply_with_cache(const T81BigInt *a, const T81BigInt *b, T81BigInt *out) {
-    char *as = NULL, *bs = NULL;
-    if (t81bigint_to_trit_string(a, &as) != 0) return 2;
-    if (t81bigint_to_trit_string(b, &bs) != 0) { free(as); return 2; }
-    char key[128];
-    snprintf(key, sizeof(key), "mul:%s:%s", as, bs);
-    free(as); free(bs);
-    if (mul_cache_lookup(key, out) == 0) return 0;
-    TritError e = t81bigint_karatsuba_multiply(a, b, out);
-    if (!e) { mul_cache_store(key, out); }
+static TritError t81_const_float(int which, int precision, T81Float* out) {
+    if (!out) return 2;
+    if (precision < 0) return 7;
+    size_t w = ((size_t)precision + T81_LIMB_TRITS - 1) / T81_LIMB_TRITS + 1;
+    T81BigInt v;
+    memset(&v, 0, sizeof(v));
+    TritError e = fx_const(which, &v, w);
+    if (!e) e = fx_to_float(out, &v, w, precision);
+    t81bigint_free(&v);
     return e;
 }
 
-TritError tritjs_multiply_big(T81BigInt* a, T81BigInt* b, T81BigInt** result) {
-    if (!a || !b) return 2;
-    *result = (T81BigInt*)calloc(1, sizeof(T81BigInt));
-    if (!*result) return 1;
-    TritError e = multiply_with_cache(a, b, *result);
-    if (e) { free(*result); *result = NULL; }
-    return e;
+TritError tritjs_const_pi(int precision, T81Float* out) {
+    return t81_const_float(T81_CONST_PI, precision, out);
 }
 
-/* --- Factorial and Power Functions --- */
-static int is_small_value(const T81BigInt *x) {
-    return (x->len == 1 && x->digits[0] < 81);
+TritError tritjs_const_e(int precision, T81Float* out) {
+    return t81_const_float(T81_CONST_E, precision, out);
 }
-static int to_small_int(const T81BigInt *x) {
-    int val = x->digits[0];
-    if (x->sign) val = -val;
-    return val;
+
+TritError tritjs_const_ln3(int precision, T81Float* out) {
+    return t81_const_float(T81_CONST_LN3, precision, out);
 }
 
-TritError tritjs_factorial_big(T81BigInt* a, T81BigInt** result) {
-    if (!a) return 2;
-    if (a->sign) return 6;
-    if (!is_small_value(a)) return 4;
-    int val = to_small_int(a);
-    if (val > 20) return 4;
-    long long f = 1;
-    for (int i = 1; i <= val; i++) f *= i;
-    *result = (T81BigInt*)calloc(1, sizeof(T81BigInt));
-    if (!*result) return 1;
-    if (allocate_digits(*result, 1)) { free(*result); *result = NULL; return 1; }
-    (*result)->digits[0] = 0; (*result)->sign = 0;
-    while (f > 0) {
-        int digit = f % BASE_81;
-        f /= BASE_81;
-        int carry = digit;
-        size_t i = 0;
-        while (carry) {
-            int val2 = (*result)->digits[i] + carry;
-            (*result)->digits[i] = val2 % BASE_81;
-            carry = val2 / BASE_81;
-            i++;
-            if (i >= (*result)->len && carry) {
-                if (allocate_digits(*result, (*result)->len + 1)) {
-                    tritbig_free(*result); *result = NULL; return 1;
-                }
-            }
-        }
+/* The first `trits` trits of pi (at least 2): the integer trits 1 0, then
+   the fraction, most significant first. *len receives the count written. */
+TritError tritjs_pi_n(int trits, int* len, int** pi) {
+    if (!len || !pi || trits < 0) return 2;
+    int n = (trits < 2) ? 2 : trits;
+    T81Float f;
+    TritError e = tritjs_const_pi(n - 2, &f);
+    if (e) return e;
+    int *out = malloc((size_t)n * sizeof(int));
+    if (!out) {
+        tritjs_float_free(&f);
+        return 1;
     }
-    while ((*result)->len > 1 && (*result)->digits[(*result)->len - 1] == 0)
-        (*result)->len--;
+    out[0] = 1;
+    out[1] = 0;
+    for (int i = 0; i < n - 2; i++)
+        out[i + 2] = (int)(f.fraction[i / 4] / t81_pow3(3 - i % 4) % 3);
+    tritjs_float_free(&f);
+    *len = n;
+    *pi = out;
     return 0;
 }
 
-TritError tritjs_power_big(T81BigInt* base, T81BigInt* exp, T81BigInt** result) {
-    if (!base || !exp) return 2;
-    if (exp->sign) return 6;
-    if (!is_small_value(exp)) return 4;
-    int e = to_small_int(exp);
-    if (e > 1000) return 4;
-    *result = (T81BigInt*)calloc(1, sizeof(T81BigInt));
-    if (!*result) return 1;
-    if (allocate_digits(*result, 1)) { free(*result); *result = NULL; return 1; }
-    (*result)->digits[0] = 1; (*result)->sign = 0;
-    for (int i = 0; i < e; i++) {
-        T81BigInt tmp;
-        memset(&tmp, 0, sizeof(tmp));
-        TritError err = multiply_with_cache(*result, base, &tmp);
-        if (err) { tritbig_free(*result); free(*result); *result = NULL; return err; }
-        t81bigint_free(*result);
-        **result = tmp;
-    }
-    if (base->sign && (e % 2) == 1)
-        (*result)->sign = 1;
-    return 0;
+/* pi to 8 trits; *len is output only. */
+TritError tritjs_pi(int* len, int** pi) {
+    return tritjs_pi_n(8, len, pi);
 }
 
-/* --- Scientific Functions via Double Conversion --- */
-static double t81bigint_to_double(T81BigInt* x) {
-    int sign = x->sign ? -1 : 1;
-    double accum = 0.0;
-    for (ssize_t i = x->len - 1; i >= 0; i--) {
-        accum = accum * BASE_81 + x->digits[i];
+/* Times pi, e and ln 3 from a cold cache at the given precision. */
+void tritjs_bench_constants(FILE *out, int trits) {
+    static const char *names[] = { "pi", "e", "ln3" };
+    TritError (*fns[])(int, T81Float*) = { tritjs_const_pi, tritjs_const_e, tritjs_const_ln3 };
+    tritjs_const_cache_clear();
+    fprintf(out, "%d trits, %zu threads\n", trits, t81_thread_count());
+    for (int i = 0; i < 3; i++) {
+        T81Float f;
+        double t0 = t81_now();
+        TritError e = fns[i](trits, &f);
+        double t = t81_now() - t0;
+        if (e) {
+            fprintf(out, "%-4s error: %s\n", names[i], trit_error_str(e));
+            continue;
+        }
+        fprintf(out, "%-4s %10.1f ms\n", names[i], t * 1e3);
+        tritjs_float_free(&f);
     }
-    return sign * accum;
 }
 
-static T81BigInt* double_to_t81bigint(double d) {
-    T81BigInt* result = (T81BigInt*)calloc(1, sizeof(T81BigInt));
-    if (!result) return NULL;
-    int sign = (d < 0) ? 1 : 0;
-    if (d < 0) d = -d;
-    size_t capacity = 16;
-    result->digits = (unsigned char*)calloc(capacity, 1);
-    result->len = 0;
-    while (d >= 1.0) {
-        int digit = (int)fmod(d, BASE_81);
-        if (result->len >= capacity) { capacity *= 2; result->digits = realloc(result->digits, capacity); }
-        result->digits[result->len++] = (unsigned char) digit;
-        d = floor(d / BASE_81);
+/* --- Ternary Logical Operations --- */
+int ternary_and(int a, int b) { return a < b ? a : b; }
+int ternary_or(int a, int b) { return a > b ? a : b; }
+int ternary_not(int a) { return 2 - a; }
+int ternary_xor(int a, int b) { return (a + b) % 3; }
+
+/* The gates act on each trit independently, over the trit-plane form.
+   Conversion goes five trits at a time: 3^5 = 243 values map to five p
+   bits and five q bits through one table, and back through another. A
+   shorter operand reads as zero-extended, and NOT covers the operand's
+   significant trits. Signs are ignored and results are non-negative. */
+enum { T81_PLANE_AND, T81_PLANE_OR, T81_PLANE_XOR };
+
+static uint16_t t81_trit5_bits[243];         /* p bits | q bits << 5 */
+static uint8_t t81_bits_trit5[1024];         /* The inverse */
+static pthread_once_t t81_trit5_once = PTHREAD_ONCE_INIT;
+
+static void t81_trit5_init(void) {
+    for (int v = 0; v < 243; v++) {
+        int bits = 0;
+        for (int i = 0, x = v; i < 5; i++, x /= 3) {
+            if (x % 3 >= 1) bits |= 1 << i;
+            if (x % 3 == 2) bits |= 1 << (i + 5);
+        }
+        t81_trit5_bits[v] = (uint16_t)bits;
+    }
+    /* q without p cannot occur in a valid vector; read it as 2. */
+    for (int bits = 0; bits < 1024; bits++) {
+        int v = 0;
+        for (int i = 5; i-- > 0;)
+            v = v * 3 + ((bits >> (i + 5)) & 1 ? 2 : (bits >> i) & 1);
+        t81_bits_trit5[bits] = (uint8_t)v;
     }
-    if (result->len == 0) { result->digits[0] = 0; result->len = 1; }
-    result->sign = sign;
-    return result;
 }
 
-TritError tritjs_sqrt_complex(T81BigInt* a, int precision, T81Complex* result) {
-    (void) precision;
-    double d = t81bigint_to_double(a);
-    double sq = sqrt(d);
-    T81BigInt* res = double_to_t81bigint(sq);
-    result->real = *res;
-    free(res);
-    result->imag.digits = NULL;
-    result->imag.len = 1;
-    result->imag.sign = 0;
+/* Sizes x for n trits with every plane bit clear, keeping its buffers
+   when they are large enough. */
+static TritError planes_resize(T81TritPlanes *x, size_t trits) {
+    size_t words = (trits + 63) / 64;
+    if (words == 0) words = 1;
+    if (words > x->capacity) {
+        uint64_t *p = realloc(x->p, words * sizeof(uint64_t));
+        if (!p) return 1;
+        x->p = p;
+        uint64_t *q = realloc(x->q, words * sizeof(uint64_t));
+        if (!q) return 1;
+        x->q = q;
+        x->capacity = words;
+    }
+    memset(x->p, 0, words * sizeof(uint64_t));
+    memset(x->q, 0, words * sizeof(uint64_t));
+    x->trits = trits;
+    x->words = words;
     return 0;
 }
 
-TritError tritjs_log3_complex(T81BigInt* a, int precision, T81Complex* result) {
-    (void) precision;
-    double d = t81bigint_to_double(a);
-    double l = log(d) / log(3);
-    T81BigInt* res = double_to_t81bigint(l);
-    result->real = *res;
-    free(res);
-    result->imag.digits = NULL;
-    result->imag.len = 1;
-    result->imag.sign = 0;
-    return 0;
+void tritjs_planes_free(T81TritPlanes* x) {
+    if (!x) return;
+    free(x->p);
+    free(x->q);
+    memset(x, 0, sizeof(*x));
 }
 
-TritError tritjs_sin_complex(T81BigInt* a, int precision, T81Complex* result) {
-    (void) precision;
-    double d = t81bigint_to_double(a);
-    double s = sin(d);
-    T81BigInt* res = double_to_t81bigint(s);
-    result->real = *res;
-    free(res);
-    result->imag.digits = NULL;
-    result->imag.len = 1;
-    result->imag.sign = 0;
+/* out must be zeroed or hold a live vector. */
+TritError tritjs_planes_from_big(const T81BigInt* x, T81TritPlanes* out) {
+    if (!x || !out) return 2;
+    pthread_once(&t81_trit5_once, t81_trit5_init);
+    size_t n = x->len, trits = 0;
+    while (n > 1 && x->limbs[n - 1] == 0) n--;
+    if (n > 1 || x->limbs[0]) {
+        trits = (n - 1) * T81_LIMB_TRITS;
+        for (T81Limb top = x->limbs[n - 1]; top; top /= 3) trits++;
+    }
+    if (planes_resize(out, trits)) return 1;
+    for (size_t j = 0; j * T81_LIMB_TRITS < trits; j++) {
+        T81Limb v = x->limbs[j];
+        uint64_t P = 0, Q = 0;
+        for (int c = 0; c < 8; c++, v /= 243) {
+            uint64_t bits = t81_trit5_bits[v % 243];
+            P |= (bits & 31) << (5 * c);
+            Q |= (bits >> 5) << (5 * c);
+        }
+        size_t w = j * T81_LIMB_TRITS / 64, off = j * T81_LIMB_TRITS % 64;
+        out->p[w] |= P << off;
+        out->q[w] |= Q << off;
+        if (off + T81_LIMB_TRITS > 64 && w + 1 < out->words) {
+            out->p[w + 1] |= P >> (64 - off);
+            out->q[w + 1] |= Q >> (64 - off);
+        }
+    }
     return 0;
 }
 
-TritError tritjs_cos_complex(T81BigInt* a, int precision, T81Complex* result) {
-    (void) precision;
-    double d = t81bigint_to_double(a);
-    double c = cos(d);
-    T81BigInt* res = double_to_t81bigint(c);
-    result->real = *res;
-    free(res);
-    result->imag.digits = NULL;
-    result->imag.len = 1;
-    result->imag.sign = 0;
+TritError tritjs_planes_to_big(const T81TritPlanes* x, T81BigInt** out) {
+    if (!x || !out) return 2;
+    pthread_once(&t81_trit5_once, t81_trit5_init);
+    size_t n = (x->trits + T81_LIMB_TRITS - 1) / T81_LIMB_TRITS;
+    T81BigInt *r = (T81BigInt*)calloc(1, sizeof(T81BigInt));
+    if (!r) return 1;
+    if (allocate_digits(r, n ? n : 1)) { tritbig_free(r); return 1; }
+    for (size_t j = 0; j < n; j++) {
+        size_t w = j * T81_LIMB_TRITS / 64, off = j * T81_LIMB_TRITS % 64;
+        uint64_t P = x->p[w] >> off, Q = x->q[w] >> off;
+        if (off + T81_LIMB_TRITS > 64 && w + 1 < x->words) {
+            P |= x->p[w + 1] << (64 - off);
+            Q |= x->q[w + 1] << (64 - off);
+        }
+        T81Limb v = 0;
+        for (int c = 8; c-- > 0;)
+            v = v * 243 + t81_bits_trit5[((P >> (5 * c)) & 31) | (((Q >> (5 * c)) & 31) << 5)];
+        r->limbs[j] = v;
+    }
+    t81bigint_normalize(r);
+    *out = r;
     return 0;
 }
 
-TritError tritjs_tan_complex(T81BigInt* a, int precision, T81Complex* result) {
-    (void) precision;
-    double d = t81bigint_to_double(a);
-    double t = tan(d);
-    T81BigInt* res = double_to_t81bigint(t);
-    result->real = *res;
-    free(res);
-    result->imag.digits = NULL;
-    result->imag.len = 1;
-    result->imag.sign = 0;
-    return 0;
+/* Plane words [i, n) of a op b. XOR adds mod 3 through the one-hot form
+   t == 0: ~p, t == 1: p & ~q, t == 2: q. */
+static void planes_op_scalar(int op, uint64_t *rp, uint64_t *rq,
+                             const uint64_t *ap, const uint64_t *aq,
+                             const uint64_t *bp, const uint64_t *bq, size_t i, size_t n) {
+    switch (op) {
+    case T81_PLANE_AND:
+        for (; i < n; i++) { rp[i] = ap[i] & bp[i]; rq[i] = aq[i] & bq[i]; }
+        break;
+    case T81_PLANE_OR:
+        for (; i < n; i++) { rp[i] = ap[i] | bp[i]; rq[i] = aq[i] | bq[i]; }
+        break;
+    case T81_PLANE_XOR:
+        for (; i < n; i++) {
+            uint64_t a0 = ~ap[i], a1 = ap[i] & ~aq[i], a2 = aq[i];
+            uint64_t b0 = ~bp[i], b1 = bp[i] & ~bq[i], b2 = bq[i];
+            uint64_t s1 = (a0 & b1) | (a1 & b0) | (a2 & b2);
+            uint64_t s2 = (a0 & b2) | (a1 & b1) | (a2 & b0);
+            rp[i] = s1 | s2;
+            rq[i] = s2;
+        }
+        break;
+    }
 }
 
-TritError tritjs_pi(int* len, int** pi) {
-    static int pi_val[] = {1, 0, 0, 1, 0, 2, 2, 1};
-    *len = 8;
-    *pi = malloc(8 * sizeof(int));
-    if (!*pi) return 1;
-    memcpy(*pi, pi_val, 8 * sizeof(int));
-    return 0;
+#if defined(__x86_64__)
+/* r = a & b or a | b over one plane, 256 trits at a time. */
+__attribute__((target("avx2")))
+static void plane_andor_avx2(int op, uint64_t *r, const uint64_t *a, const uint64_t *b, size_t n) {
+    size_t i = 0;
+    if (op == T81_PLANE_AND) {
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_si256((__m256i*)(r + i),
+                                _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(a + i)),
+                                                 _mm256_loadu_si256((const __m256i*)(b + i))));
+        for (; i < n; i++) r[i] = a[i] & b[i];
+    } else {
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_si256((__m256i*)(r + i),
+                                _mm256_or_si256(_mm256_loadu_si256((const __m256i*)(a + i)),
+                                                _mm256_loadu_si256((const __m256i*)(b + i))));
+        for (; i < n; i++) r[i] = a[i] | b[i];
+    }
 }
 
-/* --- Full Division and Modulo (Long Division Algorithm) --- */
-TritError tritjs_divide_big(T81BigInt* a, T81BigInt* b, T81BigInt** quotient, T81BigInt** remainder) {
-    if (!a || !b) return 2;
-    int b_zero = 1;
-    for (size_t i = 0; i < b->len; i++) {
-        if (b->digits[i] != 0) { b_zero = 0; break; }
-    }
-    if (b_zero) { LOG_ERROR(3, "tritjs_divide_big"); return 3; }
-    *quotient = (T81BigInt*)calloc(1, sizeof(T81BigInt));
-    *remainder = (T81BigInt*)calloc(1, sizeof(T81BigInt));
-    if (!*quotient || !*remainder) return 1;
-    if (allocate_digits(*remainder, a->len)) return 1;
-    memcpy((*remainder)->digits, a->digits, a->len);
-    (*remainder)->len = a->len;
-    if (allocate_digits(*quotient, a->len)) return 1;
-    memset((*quotient)->digits, 0, a->len);
-    for (ssize_t i = a->len - 1; i >= 0; i--) {
-        size_t newLen = (*remainder)->len + 1;
-        unsigned char* newR = calloc(newLen, 1);
-        if (!newR) return 1;
-        newR[0] = a->digits[i];
-        for (size_t j = 1; j < newLen; j++) {
-            newR[j] = (*remainder)->digits[j-1];
-        }
-        free((*remainder)->digits);
-        (*remainder)->digits = newR;
-        (*remainder)->len = newLen;
-        int q_digit = 0;
-        T81BigInt* prod = NULL;
-        T81BigInt* temp = NULL;
-        while (1) {
-            int mul_digit = q_digit + 1;
-            prod = (T81BigInt*)calloc(1, sizeof(T81BigInt));
-            if (!prod) return 1;
-            if (allocate_digits(prod, (*remainder)->len)) return 1;
-            int carry = 0;
-            for (size_t j = 0; j < (*remainder)->len; j++) {
-                int val = (j < b->len ? b->digits[j] * mul_digit : 0) + carry;
-                prod->digits[j] = val % BASE_81;
-                carry = val / BASE_81;
-            }
-            if (carry) {
-                if (allocate_digits(prod, (*remainder)->len + 1)) return 1;
-                prod->digits[(*remainder)->len] = carry;
-                prod->len = (*remainder)->len + 1;
-            } else {
-                prod->len = (*remainder)->len;
-            }
-            if (cmp_base81((*remainder)->digits, (*remainder)->len, prod->digits, prod->len) < 0) {
-                t81bigint_free(prod); free(prod);
-                break;
-            }
-            t81bigint_free(prod); free(prod);
-            q_digit++;
-        }
-        (*quotient)->digits[i] = (unsigned char) q_digit;
-        prod = (T81BigInt*)calloc(1, sizeof(T81BigInt));
-        if (!prod) return 1;
-        if (allocate_digits(prod, (*remainder)->len)) return 1;
-        int carry = 0;
-        for (size_t j = 0; j < (*remainder)->len; j++) {
-            int val = (j < b->len ? b->digits[j] * q_digit : 0) + carry;
-            prod->digits[j] = val % BASE_81;
-            carry = val / BASE_81;
-        }
-        prod->len = (*remainder)->len;
-        temp = NULL;
-        tritjs_subtract_big(*remainder, prod, &temp);
-        t81bigint_free(*remainder);
-        free((*remainder));
-        *remainder = temp;
-        t81bigint_free(prod);
-        free(prod);
-    }
-    while ((*quotient)->len > 1 && (*quotient)->digits[(*quotient)->len - 1] == 0)
-        (*quotient)->len--;
-    while ((*remainder)->len > 1 && (*remainder)->digits[(*remainder)->len - 1] == 0)
-        (*remainder)->len--;
-    (*quotient)->sign = (a->sign != b->sign) ? 1 : 0;
-    (*remainder)->sign = a->sign;
+/* The gates 256 trits at a time. AND and OR treat the planes as two
+   independent passes, which streams better than interleaving them once
+   the vectors outgrow the cache; XOR needs both planes of both operands
+   at once. The last partial block of XOR falls back to the scalar loop. */
+__attribute__((target("avx2")))
+static void planes_op_avx2(int op, uint64_t *rp, uint64_t *rq,
+                           const uint64_t *ap, const uint64_t *aq,
+                           const uint64_t *bp, const uint64_t *bq, size_t n) {
+    if (op != T81_PLANE_XOR) {
+        plane_andor_avx2(op, rp, ap, bp, n);
+        plane_andor_avx2(op, rq, aq, bq, n);
+        return;
+    }
+    size_t i = 0;
+    __m256i ones = _mm256_set1_epi64x(-1);
+    for (; i + 4 <= n; i += 4) {
+        __m256i xp = _mm256_loadu_si256((const __m256i*)(ap + i));
+        __m256i xq = _mm256_loadu_si256((const __m256i*)(aq + i));
+        __m256i yp = _mm256_loadu_si256((const __m256i*)(bp + i));
+        __m256i yq = _mm256_loadu_si256((const __m256i*)(bq + i));
+        __m256i a0 = _mm256_xor_si256(xp, ones), a1 = _mm256_andnot_si256(xq, xp);
+        __m256i b0 = _mm256_xor_si256(yp, ones), b1 = _mm256_andnot_si256(yq, yp);
+        __m256i s1 = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(a0, b1),
+                                                     _mm256_and_si256(a1, b0)),
+                                     _mm256_and_si256(xq, yq));
+        __m256i s2 = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(a0, yq),
+                                                     _mm256_and_si256(a1, b1)),
+                                     _mm256_and_si256(xq, b0));
+        _mm256_storeu_si256((__m256i*)(rp + i), _mm256_or_si256(s1, s2));
+        _mm256_storeu_si256((__m256i*)(rq + i), s2);
+    }
+    planes_op_scalar(op, rp, rq, ap, aq, bp, bq, i, n);
+}
+#endif
+
+static void planes_op_words(int op, uint64_t *rp, uint64_t *rq,
+                            const uint64_t *ap, const uint64_t *aq,
+                            const uint64_t *bp, const uint64_t *bq, size_t n) {
+#if defined(__x86_64__)
+    if (t81_have_avx2()) {
+        planes_op_avx2(op, rp, rq, ap, aq, bp, bq, n);
+        return;
+    }
+#endif
+    planes_op_scalar(op, rp, rq, ap, aq, bp, bq, 0, n);
+}
+
+/* out may alias a or b. Past the shorter operand the other one stands
+   against zero: AND gives zero, OR and XOR copy it. */
+static TritError planes_binary(int op, const T81TritPlanes *a, const T81TritPlanes *b, T81TritPlanes *out) {
+    if (!a || !b || !out) return 2;
+    if (a->trits < b->trits) { const T81TritPlanes *t = a; a = b; b = t; }
+    size_t words = (a->trits + 63) / 64, common = b->words;
+    if (words == 0) words = 1;
+    if (common > words) common = words;
+    if (words > out->capacity) {
+        T81TritPlanes grown;
+        memset(&grown, 0, sizeof(grown));
+        if (planes_resize(&grown, a->trits)) { tritjs_planes_free(&grown); return 1; }
+        planes_op_words(op, grown.p, grown.q, a->p, a->q, b->p, b->q, common);
+        tritjs_planes_free(out);
+        *out = grown;
+    } else {
+        planes_op_words(op, out->p, out->q, a->p, a->q, b->p, b->q, common);
+        out->words = words;
+    }
+    if (op == T81_PLANE_AND) {
+        memset(out->p + common, 0, (words - common) * sizeof(uint64_t));
+        memset(out->q + common, 0, (words - common) * sizeof(uint64_t));
+    } else if (out != a) {
+        memcpy(out->p + common, a->p + common, (words - common) * sizeof(uint64_t));
+        memcpy(out->q + common, a->q + common, (words - common) * sizeof(uint64_t));
+    }
+    out->trits = a->trits;
     return 0;
 }
 
-/* --- Shift Operations --- */
-TritError tritjs_left_shift(T81BigInt* a, int shift, T81BigInt** result) {
-    if (!a || shift < 0) return 2;
-    T81BigInt base;
-    memset(&base, 0, sizeof(base));
-    allocate_digits(&base, 1);
-    base.digits[0] = 3; base.sign = 0;
-    T81BigInt* shift_val = NULL;
-    char shift_str[16];
-    snprintf(shift_str, sizeof(shift_str), "%d", shift);
-    parse_trit_string(shift_str, &shift_val);
-    T81BigInt* multiplier = NULL;
-    if (tritjs_power_big(&base, shift_val, &multiplier))
-        return 1;
-    TritError e = tritjs_multiply_big(a, multiplier, result);
-    tritbig_free(multiplier);
-    t81bigint_free(&base);
-    tritbig_free(shift_val);
-    return e;
+TritError tritjs_planes_and(const T81TritPlanes* a, const T81TritPlanes* b, T81TritPlanes* out) {
+    return planes_binary(T81_PLANE_AND, a, b, out);
 }
 
-TritError tritjs_right_shift(T81BigInt* a, int shift, T81BigInt** result) {
-    if (!a || shift < 0) return 2;
-    T81BigInt base;
-    memset(&base, 0, sizeof(base));
-    allocate_digits(&base, 1);
-    base.digits[0] = 3; base.sign = 0;
-    T81BigInt* shift_val = NULL;
-    char shift_str[16];
-    snprintf(shift_str, sizeof(shift_str), "%d", shift);
-    parse_trit_string(shift_str, &shift_val);
-    T81BigInt* divisor = NULL;
-    if (tritjs_power_big(&base, shift_val, &divisor))
-        return 1;
-    T81BigInt *q = NULL, *r = NULL;
-    TritError e = tritjs_divide_big(a, divisor, &q, &r);
-    tritbig_free(divisor);
-    t81bigint_free(&base);
-    tritbig_free(shift_val);
-    if (r) { tritbig_free(r); free(r); }
-    if (!e) *result = q; else { tritbig_free(q); free(q); }
-    return e;
+TritError tritjs_planes_or(const T81TritPlanes* a, const T81TritPlanes* b, T81TritPlanes* out) {
+    return planes_binary(T81_PLANE_OR, a, b, out);
 }
 
-/* --- Ternary Logical Operations --- */
-int ternary_and(int a, int b) { return a < b ? a : b; }
-int ternary_or(int a, int b) { return a > b ? a : b; }
-int ternary_not(int a) { return 2 - a; }
-int ternary_xor(int a, int b) { return (a + b) % 3; }
+TritError tritjs_planes_xor(const T81TritPlanes* a, const T81TritPlanes* b, T81TritPlanes* out) {
+    return planes_binary(T81_PLANE_XOR, a, b, out);
+}
 
-TritError tritjs_logical_and(T81BigInt* A, T81BigInt* B, T81BigInt** result) {
-    if (!A || !B) return 2;
-    size_t len = A->len > B->len ? A->len : B->len;
-    *result = (T81BigInt*)calloc(1, sizeof(T81BigInt));
-    if (!*result) return 1;
-    if (allocate_digits(*result, len)) { free(*result); return 1; }
-    for (size_t i = 0; i < len; i++) {
-        int a = (i < A->len ? A->digits[i] : 0);
-        int b = (i < B->len ? B->digits[i] : 0);
-        (*result)->digits[i] = (unsigned char) ternary_and(a, b);
+/* 2 - t swaps and complements the planes: t <= 1 exactly when q is clear,
+   and t == 0 exactly when p is clear. out may alias a. */
+TritError tritjs_planes_not(const T81TritPlanes* a, T81TritPlanes* out) {
+    if (!a || !out) return 2;
+    if (out != a && a->words > out->capacity) {
+        T81TritPlanes grown;
+        memset(&grown, 0, sizeof(grown));
+        if (planes_resize(&grown, a->trits)) { tritjs_planes_free(&grown); return 1; }
+        tritjs_planes_free(out);
+        *out = grown;
+    }
+    for (size_t i = 0; i < a->words; i++) {
+        uint64_t p = a->p[i];
+        out->p[i] = ~a->q[i];
+        out->q[i] = ~p;
+    }
+    out->words = a->words;
+    out->trits = a->trits;
+    if (a->trits % 64) {
+        uint64_t keep = (1ULL << (a->trits % 64)) - 1;
+        out->p[out->words - 1] &= keep;
+        out->q[out->words - 1] &= keep;
+    } else if (a->trits == 0 && out->words) {
+        out->p[0] = out->q[0] = 0;
     }
-    (*result)->len = len;
-    (*result)->sign = 0;
     return 0;
 }
 
+/* The T81BigInt entry points convert, apply one gate and convert back. */
+static TritError logical_binary(int op, T81BigInt* A, T81BigInt* B, T81BigInt** result) {
+    if (!A || !B || !result) return 2;
+    T81TritPlanes a, b;
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+    TritError e = tritjs_planes_from_big(A, &a);
+    if (!e) e = tritjs_planes_from_big(B, &b);
+    if (!e) e = planes_binary(op, &a, &b, &a);
+    if (!e) e = tritjs_planes_to_big(&a, result);
+    tritjs_planes_free(&a);
+    tritjs_planes_free(&b);
+    return e;
+}
+
+TritError tritjs_logical_and(T81BigInt* A, T81BigInt* B, T81BigInt** result) {
+    return logical_binary(T81_PLANE_AND, A, B, result);
+}
+
 TritError tritjs_logical_or(T81BigInt* A, T81BigInt* B, T81BigInt** result) {
-    if (!A || !B) return 2;
-    size_t len = A->len > B->len ? A->len : B->len;
-    *result = (T81BigInt*)calloc(1, sizeof(T81BigInt));
-    if (!*result) return 1;
-    if (allocate_digits(*result, len)) { free(*result); return 1; }
-    for (size_t i = 0; i < len; i++) {
-        int a = (i < A->len ? A->digits[i] : 0);
-        int b = (i < B->len ? B->digits[i] : 0);
-        (*result)->digits[i] = (unsigned char) ternary_or(a, b);
-    }
-    (*result)->len = len;
-    (*result)->sign = 0;
-    return 0;
+    return logical_binary(T81_PLANE_OR, A, B, result);
 }
 
 TritError tritjs_logical_not(T81BigInt* A, T81BigInt** result) {
-    if (!A) return 2;
-    *result = (T81BigInt*)calloc(1, sizeof(T81BigInt));
-    if (!*result) return 1;
-    if (allocate_digits(*result, A->len)) { free(*result); return 1; }
-    for (size_t i = 0; i < A->len; i++) {
-        (*result)->digits[i] = (unsigned char) ternary_not(A->digits[i]);
-    }
-    (*result)->len = A->len;
-    (*result)->sign = 0;
-    return 0;
+    if (!A || !result) return 2;
+    T81TritPlanes a;
+    memset(&a, 0, sizeof(a));
+    TritError e = tritjs_planes_from_big(A, &a);
+    if (!e) e = tritjs_planes_not(&a, &a);
+    if (!e) e = tritjs_planes_to_big(&a, result);
+    tritjs_planes_free(&a);
+    return e;
 }
 
 TritError tritjs_logical_xor(T81BigInt* A, T81BigInt* B, T81BigInt** result) {
-    if (!A || !B) return 2;
-    size_t len = A->len > B->len ? A->len : B->len;
-    *result = (T81BigInt*)calloc(1, sizeof(T81BigInt));
-    if (!*result) return 1;
-    if (allocate_digits(*result, len)) { free(*result); return 1; }
-    for (size_t i = 0; i < len; i++) {
-        int a = (i < A->len ? A->digits[i] : 0);
-        int b = (i < B->len ? B->digits[i] : 0);
-        (*result)->digits[i] = (unsigned char) ternary_xor(a, b);
-    }
-    (*result)->len = len;
-    (*result)->sign = 0;
-    return 0;
+    return logical_binary(T81_PLANE_XOR, A, B, result);
 }
 
 /* --- Lua Integration --- */
@@ -1143,6 +5303,285 @@ void run_lua_script(const char *script) {
     lua_close(L);
 }
 
+/* --- Self-Check --- */
+/* `--self-check` shrinks the cutoffs until every multiplication tier,
+   both fast division algorithms and the worker pool run on operands of a
+   few limbs, then compares their results with the schoolbook kernels.
+   Batch results are checked against the one-value calls, mapped buffers
+   against heap ones, and copy-on-write values against an unshared copy.
+   Each mismatch prints a line; the cutoffs are restored afterwards. */
+
+static void selfcheck_fill(T81Limb *x, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        x[i] = (((T81Limb)rand() << 42) ^ ((T81Limb)rand() << 21) ^ (T81Limb)rand()) % T81_LIMB_BASE;
+}
+
+/* *x = a random value of n limbs with a random sign. */
+static TritError selfcheck_random(T81BigInt **x, size_t n) {
+    *x = (T81BigInt*)calloc(1, sizeof(T81BigInt));
+    if (!*x) return 1;
+    TritError e = allocate_digits(*x, n);
+    if (e) { free(*x); *x = NULL; return e; }
+    selfcheck_fill((*x)->limbs, n);
+    (*x)->sign = rand() & 1;
+    t81bigint_normalize(*x);
+    return 0;
+}
+
+static int selfcheck_expect(FILE *out, int ok, const char *what, size_t n) {
+    if (!ok) fprintf(out, "self-check: %s wrong at %zu limbs\n", what, n);
+    return !ok;
+}
+
+/* Each tier forced at the top level, then t81_mul() on unbalanced
+   operands, which also takes the NTT and forks onto the worker pool. */
+static int selfcheck_multiply(FILE *out) {
+    static const char *names[] = { "karatsuba", "toom3", "toom4", "ntt" };
+    static const T81MulKernel kernels[] = { karatsuba, toom3, toom4, bench_ntt };
+    enum { NMAX = 200 };
+    int fails = 0;
+    T81Limb *A = malloc(2 * NMAX * sizeof(T81Limb));
+    T81Limb *B = malloc(NMAX * sizeof(T81Limb));
+    T81Limb *P = malloc(3 * NMAX * sizeof(T81Limb));
+    T81Limb *Q = malloc(3 * NMAX * sizeof(T81Limb));
+    if (!A || !B || !P || !Q) {
+        free(A); free(B); free(P); free(Q);
+        fprintf(out, "self-check: out of memory\n");
+        return 1;
+    }
+    selfcheck_fill(A, 2 * NMAX);
+    selfcheck_fill(B, NMAX);
+    for (size_t n = 1; n <= NMAX; n += (n < 40) ? 1 : 23) {
+        if (t81_arena_reserve(toom4_own_scratch(n) + t81_mul_scratch(n) + t81_ntt_scratch(2 * n))) {
+            fails++;
+            break;
+        }
+        for (int sq = 0; sq < 2; sq++) {
+            const T81Limb *b = sq ? A : B;
+            naive_mul(A, n, b, n, Q);
+            for (int k = 0; k < 4; k++) {
+                kernels[k](A, b, n, P);
+                fails += selfcheck_expect(out, memcmp(P, Q, 2 * n * sizeof(T81Limb)) == 0, names[k], n);
+            }
+        }
+    }
+    static const size_t bns[] = { 7, 31, 64, 150, 2 * NMAX };
+    static const size_t sns[] = { 1, 4, 5, 13, 30, 64, 150, NMAX };
+    for (size_t i = 0; i < sizeof(bns) / sizeof(bns[0]); i++)
+        for (size_t j = 0; j < sizeof(sns) / sizeof(sns[0]) && sns[j] <= bns[i]; j++) {
+            size_t bn = bns[i], sn = sns[j];
+            if (t81_arena_reserve(t81_mul_any_scratch(bn, sn))) {
+                fails++;
+                break;
+            }
+            naive_mul(A, bn, B, sn, Q);
+            t81_mul(P, A, bn, B, sn);
+            fails += selfcheck_expect(out, memcmp(P, Q, (bn + sn) * sizeof(T81Limb)) == 0, "t81_mul", bn);
+        }
+    free(A); free(B); free(P); free(Q);
+    tritjs_scratch_release();
+    return fails;
+}
+
+/* Divides with the divide-and-conquer and Newton cutoffs in force, with
+   a precomputed reciprocal, and with both cutoffs off. */
+static int selfcheck_divide(FILE *out, size_t div_dc, size_t div_newton) {
+    static const size_t dns[] = { 1, 2, 3, 5, 9, 17, 40, 75 };
+    int fails = 0;
+    for (size_t i = 0; i < sizeof(dns) / sizeof(dns[0]); i++)
+        for (size_t an = dns[i]; an <= 3 * dns[i] + 20; an += dns[i] + 7) {
+            T81BigInt *a = NULL, *b = NULL, *q[3] = { NULL }, *r[3] = { NULL };
+            T81Reciprocal rc;
+            memset(&rc, 0, sizeof(rc));
+            TritError e = selfcheck_random(&a, an);
+            if (!e) e = selfcheck_random(&b, dns[i]);
+            if (!e && b->len == 1 && b->limbs[0] == 0) b->limbs[0] = 1;
+            if (!e) {
+                t81_tuning.div_dc = div_dc;
+                t81_tuning.div_newton = div_newton;
+                e = tritjs_divide_big(a, b, &q[0], &r[0]);
+            }
+            if (!e) e = tritjs_reciprocal_init(&rc, b);
+            if (!e) e = tritjs_divide_reciprocal(a, &rc, &q[1], &r[1]);
+            if (!e) {
+                t81_tuning.div_dc = SIZE_MAX;
+                t81_tuning.div_newton = SIZE_MAX;
+                e = tritjs_divide_big(a, b, &q[2], &r[2]);
+            }
+            if (e) {
+                fprintf(out, "self-check: division failed: %s\n", trit_error_str(e));
+                fails++;
+            } else {
+                fails += selfcheck_expect(out, !tritjs_compare(q[0], q[2]) && !tritjs_compare(r[0], r[2]),
+                                          "division", dns[i]);
+                fails += selfcheck_expect(out, !tritjs_compare(q[1], q[2]) && !tritjs_compare(r[1], r[2]),
+                                          "reciprocal division", dns[i]);
+            }
+            tritjs_reciprocal_free(&rc);
+            for (int k = 0; k < 3; k++) { tritbig_free(q[k]); tritbig_free(r[k]); }
+            tritbig_free(a);
+            tritbig_free(b);
+        }
+    return fails;
+}
+
+/* Batch results against the one-value calls, over one- and multi-limb
+   values. */
+static int selfcheck_batch(FILE *out) {
+    enum { N = 64 };
+    TritError (*ops[])(T81BigInt*, T81BigInt*, T81BigInt**) = {
+        tritjs_add_big, tritjs_subtract_big, tritjs_multiply_big };
+    TritError (*batch_ops[])(const T81Batch*, const T81Batch*, T81Batch*) = {
+        tritjs_batch_add, tritjs_batch_sub, tritjs_batch_mul };
+    static const char *names[] = { "batch add", "batch sub", "batch mul" };
+    T81BigInt *x[2 * N] = { NULL };
+    T81Batch A, B, R;
+    int c[N];
+    int fails = 0;
+    memset(&A, 0, sizeof(A));
+    memset(&B, 0, sizeof(B));
+    memset(&R, 0, sizeof(R));
+    TritError e = 0;
+    /* Operand lengths run over every pair from 1 to 4 limbs. */
+    for (size_t i = 0; !e && i < 2 * N; i++) {
+        e = selfcheck_random(&x[i], 1 + (i < N ? i % 4 : (i - N) / 4 % 4));
+        if (!e) e = tritjs_batch_push(i < N ? &A : &B, x[i]);
+    }
+    for (int k = 0; !e && k < 3; k++) {
+        e = batch_ops[k](&A, &B, &R);
+        for (size_t i = 0; !e && i < N; i++) {
+            T81BigInt *want = NULL, *got = NULL;
+            e = ops[k](x[i], x[N + i], &want);
+            if (!e) e = tritjs_batch_get(&R, i, &got);
+            if (!e) fails += selfcheck_expect(out, !tritjs_compare(want, got), names[k], A.len[i]);
+            tritbig_free(want);
+            tritbig_free(got);
+        }
+    }
+    if (!e) e = tritjs_batch_compare(&A, &B, c);
+    for (size_t i = 0; !e && i < N; i++)
+        fails += selfcheck_expect(out, c[i] == tritjs_compare(x[i], x[N + i]), "batch compare", A.len[i]);
+    if (e) {
+        fprintf(out, "self-check: batch failed: %s\n", trit_error_str(e));
+        fails++;
+    }
+    for (size_t i = 0; i < 2 * N; i++) tritbig_free(x[i]);
+    tritjs_batch_free(&A);
+    tritjs_batch_free(&B);
+    tritjs_batch_free(&R);
+    return fails;
+}
+
+/* Repeats a product, a sum and a division in a context that maps every
+   buffer, once per backend, and compares with the heap results. */
+static int selfcheck_mapped(FILE *out) {
+    T81BigInt *a = NULL, *b = NULL, *want[4] = { NULL };
+    T81Context *ctx = tritjs_context_new();
+    int fails = 0;
+    TritError e = ctx ? 0 : 1;
+    if (!e) e = selfcheck_random(&a, 90);
+    if (!e) e = selfcheck_random(&b, 33);
+    if (!e) e = tritjs_multiply_big(a, b, &want[0]);
+    if (!e) e = tritjs_add_big(a, b, &want[1]);
+    if (!e) e = tritjs_divide_big(a, b, &want[2], &want[3]);
+    if (!e) e = tritjs_context_set(ctx, "mmap_bytes", 1);
+    for (size_t m = 0; !e && m < T81_MAP_BACKENDS; m++) {
+        T81Context *prev = tritjs_context_use(ctx);
+        T81BigInt *got[4] = { NULL };
+        e = tritjs_context_set(ctx, "map_backend", m);
+        if (!e) e = tritjs_multiply_big(a, b, &got[0]);
+        if (!e) e = tritjs_add_big(a, b, &got[1]);
+        if (!e) e = tritjs_divide_big(a, b, &got[2], &got[3]);
+        tritjs_context_use(prev);
+        for (int k = 0; !e && k < 4; k++)
+            fails += selfcheck_expect(out, got[k]->is_mapped && !tritjs_compare(want[k], got[k]),
+                                      t81_map_names[m], got[k]->len);
+        for (int k = 0; k < 4; k++) tritbig_free(got[k]);
+    }
+    if (e) {
+        fprintf(out, "self-check: mapped buffers failed: %s\n", trit_error_str(e));
+        fails++;
+    }
+    for (int k = 0; k < 4; k++) tritbig_free(want[k]);
+    tritbig_free(a);
+    tritbig_free(b);
+    tritjs_context_free(ctx);
+    return fails;
+}
+
+/* Shares a value, writes each side, and checks the other kept its value;
+   then does the same with a product shared with the product cache. */
+static int selfcheck_cow(FILE *out) {
+    T81BigInt *x = NULL, *b = NULL, *y = NULL, *keep = NULL, *sum = NULL;
+    T81BigInt *p[3] = { NULL };
+    T81BigInt one;
+    memset(&one, 0, sizeof(one));
+    int fails = 0;
+    TritError e = selfcheck_random(&x, 12);
+    if (!e) e = selfcheck_random(&b, 12);
+    if (!e) e = allocate_digits(&one, 1);
+    if (!e) {
+        one.limbs[0] = 1;
+        e = tritjs_add_big(x, &one, &sum);
+    }
+    if (!e) e = tritjs_copy(x, &keep);
+    if (!e) e = t81bigint_reserve(keep, keep->len);
+    if (!e) e = tritjs_copy(x, &y);
+    if (!e) e = tritjs_add_into(y, y, &one);
+    if (!e) fails += selfcheck_expect(out, !tritjs_compare(y, sum) && !tritjs_compare(x, keep), "shared copy", x->len);
+    if (!e) {
+        tritbig_free(y);
+        e = tritjs_copy(x, &y);
+    }
+    if (!e) e = tritjs_add_into(x, x, &one);
+    if (!e) fails += selfcheck_expect(out, !tritjs_compare(x, sum) && !tritjs_compare(y, keep), "shared original", x->len);
+    if (!e) {
+        tritjs_mul_cache_clear();
+        e = tritjs_multiply_big(x, b, &p[0]);
+    }
+    if (!e) e = tritjs_multiply_big(x, b, &p[1]);
+    if (!e) e = tritjs_add_into(p[0], p[0], &one);
+    if (!e) e = tritjs_sub_into(p[1], p[1], &one);
+    if (!e) e = tritjs_multiply_big(x, b, &p[2]);
+    if (!e) e = tritjs_sub_into(p[0], p[0], &one);
+    if (!e) e = tritjs_add_into(p[1], p[1], &one);
+    if (!e) fails += selfcheck_expect(out, !tritjs_compare(p[0], p[2]) && !tritjs_compare(p[1], p[2]),
+                                      "cached product", p[2]->len);
+    if (e) {
+        fprintf(out, "self-check: copy-on-write failed: %s\n", trit_error_str(e));
+        fails++;
+    }
+    for (int k = 0; k < 3; k++) tritbig_free(p[k]);
+    t81bigint_free(&one);
+    tritbig_free(x);
+    tritbig_free(b);
+    tritbig_free(y);
+    tritbig_free(keep);
+    tritbig_free(sum);
+    return fails;
+}
+
+/* Runs every check and returns the number of mismatches. */
+int tritjs_self_check(FILE *out) {
+    t81_tuning_init();
+    T81Tuning saved = t81_tuning;
+    t81_tuning.karatsuba = 3;
+    t81_tuning.toom3 = 6;
+    t81_tuning.toom4 = 12;
+    t81_tuning.ntt = 48;
+    t81_tuning.par_mul = 8;
+    tritjs_mul_cache_clear();
+    int fails = selfcheck_multiply(out);
+    fails += selfcheck_divide(out, 4, 8);
+    fails += selfcheck_batch(out);
+    fails += selfcheck_mapped(out);
+    fails += selfcheck_cow(out);
+    tritjs_mul_cache_clear();
+    t81_tuning = saved;
+    fprintf(out, "self-check: %d mismatch%s\n", fails, fails == 1 ? "" : "es");
+    return fails;
+}
+
 /* --- Integration Test Cases --- */
 void run_integration_tests() {
     /* Crypto Test using OpenSSL AES-256-GCM */
@@ -1179,7 +5618,38 @@ void run_integration_tests() {
 
 /* --- Main Function --- */
 /* (Assumes functions like start_intrusion_monitor(), init_ncurses_interface(), ncurses_loop(), and end_ncurses_interface() are fully implemented elsewhere.) */
-int main() {
+int main(int argc, char **argv) {
+    if (argc > 2 && strcmp(argv[1], "--map") == 0) {
+        if (tritjs_set_map_backend(argv[2])) {
+            fprintf(stderr, "--map takes anon, memfd or file\n");
+            return 1;
+        }
+        argc -= 2;
+        argv += 2;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-mul") == 0) {
+        tritjs_bench_multiply(stdout);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-sci") == 0) {
+        tritjs_bench_scientific(stdout);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-const") == 0) {
+        tritjs_bench_constants(stdout, argc > 2 ? atoi(argv[2]) : 1000000);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-batch") == 0) {
+        tritjs_bench_batch(stdout, argc > 2 ? (size_t)atol(argv[2]) : 1000000);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--self-check") == 0)
+        return tritjs_self_check(stdout) ? 1 : 0;
+    if (argc > 1 && strcmp(argv[1], "--tune") == 0) {
+        TritError e = tritjs_tune(argc > 2 ? argv[2] : NULL, stdout);
+        if (e) fprintf(stderr, "tune failed: %s\n", trit_error_str(e));
+        return e ? 1 : 0;
+    }
     init_audit_log();
     start_intrusion_monitor();
     run_integration_tests();